@@ -1,6 +1,7 @@
 #include "core/channel/xrpc_channel.h"
 #include "core/controller/xrpc_controller.h"
 #include "core/common/xrpc_logger.h"
+#include "core/coro/xrpc_coro.h"
 #include "user_service.pb.h"
 #include <google/protobuf/stubs/callback.h>
 #include <iostream>
@@ -123,14 +124,42 @@ public:
         return false;
     }
 
+#ifdef XRPC_HAS_COROUTINES
+    // 协程调用：响应和 done 都在协程帧内，不需要 AsyncCallback
+    xrpc::Task<bool> CoroLogin(const std::string& username, const std::string& password,
+                               example::LoginResponse& response) {
+        xrpc::XrpcChannel channel(config_file_);
+        example::UserService_Stub stub(&channel);
+        xrpc::XrpcController controller;
+        example::LoginRequest request;
+        request.set_username(username);
+        request.set_password(password);
+
+        XRPC_LOG_INFO("Sending coroutine Login request for user: {}", username);
+        response = co_await xrpc::CoCall(&stub, &example::UserService_Stub::Login, &controller, request);
+
+        if (controller.Failed() || !response.success()) {
+            std::string error = controller.Failed() ? controller.ErrorText() : response.error_message();
+            XRPC_LOG_ERROR("Coroutine Login failed for user {}: {}", username, error);
+            std::cout << "[ERROR] Coroutine Login failed for user " << username << ": " << error << std::endl;
+            co_return false;
+        }
+
+        XRPC_LOG_INFO("Coroutine Login succeeded for user: {}", username);
+        std::cout << "[INFO] Coroutine Login succeeded for user: " << username << ", token: " << response.token() << std::endl;
+        co_return true;
+    }
+#endif
+
 private:
     std::string config_file_;
 };
 
 void PrintUsage() {
-    std::cerr << "Usage: ./user_client [--sync | --async | --help] [--threads N]\n"
+    std::cerr << "Usage: ./user_client [--sync | --async | --coro | --help] [--threads N]\n"
               << "  --sync      : Use synchronous calls\n"
               << "  --async     : Use asynchronous calls\n"
+              << "  --coro      : Use coroutine calls (requires XRPC_ENABLE_COROUTINES)\n"
               << "  --threads N : Number of concurrent threads (default: 1, max: 10)\n"
               << "  --help      : Show this help message\n";
 }
@@ -139,6 +168,7 @@ int main(int argc, char* argv[]) {
     zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
     bool use_sync = false;
     bool use_async = false;
+    bool use_coro = false;
     int thread_count = 1;
 
     // 解析命令行参数
@@ -148,6 +178,13 @@ int main(int argc, char* argv[]) {
             use_sync = true;
         } else if (arg == "--async") {
             use_async = true;
+        } else if (arg == "--coro") {
+#ifdef XRPC_HAS_COROUTINES
+            use_coro = true;
+#else
+            std::cerr << "Coroutine support not built, reconfigure with -DXRPC_ENABLE_COROUTINES=ON" << std::endl;
+            return 1;
+#endif
         } else if (arg == "--threads" && i + 1 < argc) {
             thread_count = std::stoi(argv[++i]);
             if (thread_count < 1) {
@@ -163,7 +200,7 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (!use_sync && !use_async) {
+    if (!use_sync && !use_async && !use_coro) {
         PrintUsage();
         return 1;
     }
@@ -191,15 +228,19 @@ int main(int argc, char* argv[]) {
 
     // 多线程发送请求
     for (int i = 0; i < thread_count; ++i) {
-        threads.emplace_back([&client, &test_users, use_sync, use_async, i, &success_count, &fail_count]() {
+        threads.emplace_back([&client, &test_users, use_sync, use_async, use_coro, i, &success_count, &fail_count]() {
             size_t user_idx = i % test_users.size();
             const auto& user = test_users[user_idx];
             example::LoginResponse response;
-            bool success;
+            bool success = false;
             if (use_sync) {
                 success = client.SyncLogin(user.first, user.second, response);
             } else if (use_async) {
                 success = client.AsyncLogin(user.first, user.second, response);
+            } else if (use_coro) {
+#ifdef XRPC_HAS_COROUTINES
+                success = xrpc::SyncWait(client.CoroLogin(user.first, user.second, response));
+#endif
             }
             if (success) {
                 success_count++;
@@ -0,0 +1,200 @@
+#include "core/channel/load_balancer.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace xrpc {
+
+namespace {
+// splitmix64 的收尾混合，连续的 request_id 也能均匀分散
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t Random() {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    return rng();
+}
+
+class RoundRobinBalancer : public LoadBalancer {
+public:
+    explicit RoundRobinBalancer(EndpointList endpoints) : LoadBalancer(std::move(endpoints)) {}
+
+    const std::shared_ptr<Endpoint>& Select(uint64_t) const override {
+        uint64_t n = next_.fetch_add(1, std::memory_order_relaxed);
+        return endpoints_[n % endpoints_.size()];
+    }
+
+private:
+    mutable std::atomic<uint64_t> next_{0};
+};
+
+// 按权重随机：在权重前缀和上二分查找
+class WeightedRandomBalancer : public LoadBalancer {
+public:
+    explicit WeightedRandomBalancer(EndpointList endpoints) : LoadBalancer(std::move(endpoints)) {
+        uint64_t total = 0;
+        for (const auto& endpoint : endpoints_) {
+            total += endpoint->weight;
+            prefix_.push_back(total);
+        }
+    }
+
+    const std::shared_ptr<Endpoint>& Select(uint64_t) const override {
+        uint64_t point = Random() % prefix_.back();
+        size_t index = std::upper_bound(prefix_.begin(), prefix_.end(), point) - prefix_.begin();
+        return endpoints_[index];
+    }
+
+private:
+    std::vector<uint64_t> prefix_;
+};
+
+// 随机取两个实例，选负载较低的一个
+class PowerOfTwoBalancer : public LoadBalancer {
+public:
+    PowerOfTwoBalancer(EndpointList endpoints, bool use_latency)
+        : LoadBalancer(std::move(endpoints)), use_latency_(use_latency) {}
+
+    const std::shared_ptr<Endpoint>& Select(uint64_t) const override {
+        size_t n = endpoints_.size();
+        if (n == 1) {
+            return endpoints_[0];
+        }
+        size_t a = Random() % n;
+        size_t b = Random() % (n - 1);
+        if (b >= a) {
+            ++b;
+        }
+        return Load(*endpoints_[b]) < Load(*endpoints_[a]) ? endpoints_[b] : endpoints_[a];
+    }
+
+private:
+    // 尚无延迟样本的实例得分最低，会先被探测
+    int64_t Load(const Endpoint& endpoint) const {
+        int64_t inflight = endpoint.inflight.load(std::memory_order_relaxed);
+        if (!use_latency_) {
+            return inflight;
+        }
+        return (endpoint.ewma_latency_us.load(std::memory_order_relaxed) + 1) * (inflight + 1);
+    }
+
+    bool use_latency_;
+};
+
+// 一致性哈希环：每个实例按权重放置若干虚拟节点
+class RingHashBalancer : public LoadBalancer {
+public:
+    explicit RingHashBalancer(EndpointList endpoints) : LoadBalancer(std::move(endpoints)) {
+        for (size_t i = 0; i < endpoints_.size(); ++i) {
+            size_t replicas = kRingReplicas * endpoints_[i]->weight;
+            for (size_t r = 0; r < replicas; ++r) {
+                ring_.emplace_back(HashKey(endpoints_[i]->address + "#" + std::to_string(r)), i);
+            }
+        }
+        std::sort(ring_.begin(), ring_.end());
+    }
+
+    const std::shared_ptr<Endpoint>& Select(uint64_t request_key) const override {
+        auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(Mix(request_key), size_t(0)));
+        if (it == ring_.end()) {
+            it = ring_.begin();
+        }
+        return endpoints_[it->second];
+    }
+
+private:
+    std::vector<std::pair<uint64_t, size_t>> ring_;
+};
+
+// Maglev 哈希：各实例按自己的排列轮流填充查找表，查找为一次取模；不考虑权重
+class MaglevBalancer : public LoadBalancer {
+public:
+    explicit MaglevBalancer(EndpointList endpoints)
+        : LoadBalancer(std::move(endpoints)), table_(kMaglevTableSize, kEmpty) {
+        const uint64_t m = kMaglevTableSize;
+        size_t n = endpoints_.size();
+        std::vector<uint64_t> offset(n);
+        std::vector<uint64_t> skip(n);
+        std::vector<uint64_t> next(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t h = HashKey(endpoints_[i]->address);
+            offset[i] = h % m;
+            skip[i] = Mix(h) % (m - 1) + 1;
+        }
+        size_t filled = 0;
+        while (true) {
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t slot = (offset[i] + next[i] * skip[i]) % m;
+                while (table_[slot] != kEmpty) {
+                    ++next[i];
+                    slot = (offset[i] + next[i] * skip[i]) % m;
+                }
+                table_[slot] = static_cast<uint32_t>(i);
+                ++next[i];
+                if (++filled == m) {
+                    return;
+                }
+            }
+        }
+    }
+
+    const std::shared_ptr<Endpoint>& Select(uint64_t request_key) const override {
+        return endpoints_[table_[Mix(request_key) % table_.size()]];
+    }
+
+private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+    std::vector<uint32_t> table_;
+};
+} // namespace
+
+void Endpoint::RecordLatency(int64_t latency_us) {
+    int64_t old = ewma_latency_us.load(std::memory_order_relaxed);
+    // 新样本权重 1/8
+    int64_t updated = old == 0 ? latency_us : old + (latency_us - old) / 8;
+    ewma_latency_us.store(updated > 0 ? updated : 1, std::memory_order_relaxed);
+}
+
+uint64_t HashKey(std::string_view key) {
+    // FNV-1a，再混合一次改善低位分布
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return Mix(hash);
+}
+
+std::unique_ptr<LoadBalancer> LoadBalancer::Create(const std::string& policy, EndpointList endpoints) {
+    if (endpoints.empty()) {
+        throw std::invalid_argument("LoadBalancer requires at least one endpoint");
+    }
+    if (policy == "round_robin") {
+        return std::unique_ptr<LoadBalancer>(new RoundRobinBalancer(std::move(endpoints)));
+    }
+    if (policy == "weighted_random") {
+        return std::unique_ptr<LoadBalancer>(new WeightedRandomBalancer(std::move(endpoints)));
+    }
+    if (policy == "p2c_inflight") {
+        return std::unique_ptr<LoadBalancer>(new PowerOfTwoBalancer(std::move(endpoints), false));
+    }
+    if (policy == "p2c_ewma") {
+        return std::unique_ptr<LoadBalancer>(new PowerOfTwoBalancer(std::move(endpoints), true));
+    }
+    if (policy == "ring_hash") {
+        return std::unique_ptr<LoadBalancer>(new RingHashBalancer(std::move(endpoints)));
+    }
+    if (policy == "maglev") {
+        return std::unique_ptr<LoadBalancer>(new MaglevBalancer(std::move(endpoints)));
+    }
+    throw std::invalid_argument("Unknown load balancing policy: " + policy);
+}
+
+} // namespace xrpc
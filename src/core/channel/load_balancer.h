@@ -0,0 +1,62 @@
+#ifndef XRPC_LOAD_BALANCER_H
+#define XRPC_LOAD_BALANCER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xrpc {
+
+struct EndpointPool;
+
+// 负载均衡看到的一个服务实例，实例列表刷新时按地址复用，调用统计得以保留
+struct Endpoint {
+    std::string address; // "ip:port"
+    std::string ip;
+    int port = 0;
+    uint32_t weight = 1;
+    EndpointPool* pool = nullptr; // 传输层中该地址的连接池，创建 Endpoint 时取得，发送时不再按地址查找
+    std::atomic<int> inflight{0};              // 本 channel 发往该实例、尚未完成的调用数
+    std::atomic<int64_t> ewma_latency_us{0};   // 调用耗时的指数滑动平均，0 表示尚无样本
+
+    // 记录一次调用耗时；并发记录时可能丢失个别样本，不影响选择
+    void RecordLatency(int64_t latency_us);
+};
+
+using EndpointList = std::vector<std::shared_ptr<Endpoint>>;
+
+// 稳定的 64 位哈希，一致性哈希在不同进程间得到相同的结果
+// 调用方可用它为 XrpcController::SetRequestKey 生成键
+uint64_t HashKey(std::string_view key);
+
+// 负载均衡策略：每个实例列表构造一个对象，构造后只读，Select 可并发调用且不加锁
+class LoadBalancer {
+public:
+    virtual ~LoadBalancer() = default;
+
+    // request_key 只被一致性哈希策略使用
+    virtual const std::shared_ptr<Endpoint>& Select(uint64_t request_key) const = 0;
+
+    const EndpointList& Endpoints() const { return endpoints_; }
+
+    // policy 为 round_robin / weighted_random / p2c_inflight / p2c_ewma / ring_hash / maglev
+    // endpoints 不能为空；未知策略抛出 std::invalid_argument
+    static std::unique_ptr<LoadBalancer> Create(const std::string& policy, EndpointList endpoints);
+
+    // 一致性哈希环上每单位权重的虚拟节点数
+    static constexpr size_t kRingReplicas = 100;
+    // Maglev 查找表大小（质数），远大于实例数时各实例分到的槽位接近均匀
+    static constexpr size_t kMaglevTableSize = 16411;
+
+protected:
+    explicit LoadBalancer(EndpointList endpoints) : endpoints_(std::move(endpoints)) {}
+
+    EndpointList endpoints_;
+};
+
+} // namespace xrpc
+
+#endif // XRPC_LOAD_BALANCER_H
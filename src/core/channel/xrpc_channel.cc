@@ -2,18 +2,23 @@
 #include "core/common/xrpc_logger.h"
 #include "core/controller/xrpc_controller.h"
 #include "xrpc.pb.h"
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
 
 namespace xrpc {
 
-XrpcChannel::XrpcChannel(const std::string& config_file) : zk_client_(new ZookeeperClient), transport_(new AsioTransport) {
+XrpcChannel::XrpcChannel(const std::string& config_file)
+    : zk_client_(new ZookeeperClient), next_request_id_(1), routes_(std::make_shared<RouteTable>()) {
     config_.Load(config_file);
+    transport_.reset(new AsioTransport(std::stoul(config_.Get("io_threads", "1")),
+                                       IoContextPool::ParseBalance(config_.Get("io_balance", "round_robin"))));
+    transport_->SetConnectionPoolSize(std::stoul(config_.Get("pool_min_connections", "1")),
+                                      std::stoul(config_.Get("pool_max_connections", "4")));
     Init();
 }
 
 XrpcChannel::~XrpcChannel() {
-    std::lock_guard<std::mutex> lock(mutex_);
     transport_->Stop();
     zk_client_->Stop();
 }
@@ -21,45 +26,150 @@ XrpcChannel::~XrpcChannel() {
 void XrpcChannel::Init() {
     // 初始化 ZooKeeper
     zk_client_->Start(); // 从 XrpcConfig 获取配置
+    zk_client_->AddServiceListener([this](const std::string& service) { RefreshRoutes(service); });
 }
 
-std::string XrpcChannel::GetServiceAddress(const std::string& service_name, const std::string& method_name) {
-    // 通过服务名和方法名查找实例
-    std::vector<std::string> instances = zk_client_->FindInstancesByMethod(service_name, method_name);
-    if (instances.empty()) {
-        XRPC_LOG_ERROR("No instances found for service {} method {}", service_name, method_name);
+std::shared_ptr<Endpoint> XrpcChannel::SelectEndpoint(const google::protobuf::MethodDescriptor* method,
+                                                      uint64_t request_key) {
+    std::shared_ptr<const RouteTable> routes = std::atomic_load(&routes_);
+    auto it = routes->find(method);
+    if (it != routes->end()) {
+        return it->second->Select(request_key);
+    }
+    return ResolveRoute(method)->Select(request_key);
+}
+
+std::shared_ptr<const LoadBalancer> XrpcChannel::ResolveRoute(const google::protobuf::MethodDescriptor* method) {
+    std::lock_guard<std::mutex> lock(routes_mutex_);
+    std::shared_ptr<const RouteTable> current = std::atomic_load(&routes_);
+    auto it = current->find(method);
+    if (it != current->end()) { // 等锁期间已由其他线程解析
+        return it->second;
+    }
+
+    const std::string& service_name = method->service()->name();
+    std::shared_ptr<const InstanceList> instances = zk_client_->FindInstancesByMethod(service_name, method->name());
+    if (instances->empty()) {
+        XRPC_LOG_ERROR("No instances found for service {} method {}", service_name, method->name());
         throw std::runtime_error("Service instance not found");
     }
+    std::shared_ptr<const LoadBalancer> balancer = BuildBalancer(service_name, *instances);
 
-    // 选择第一个实例（可扩展为负载均衡）
-    std::string address = instances[0];
-    XRPC_LOG_DEBUG("Discovered service {} method {} at {}", service_name, method_name, address);
+    auto table = std::make_shared<RouteTable>(*current);
+    (*table)[method] = balancer;
+    std::atomic_store(&routes_, std::shared_ptr<const RouteTable>(std::move(table)));
+    return balancer;
+}
 
-    // 解析地址为 ip:port
-    size_t colon_pos = address.find(':');
-    if (colon_pos == std::string::npos) {
-        XRPC_LOG_ERROR("Invalid address format: {}", address);
-        throw std::runtime_error("Invalid address format");
+void XrpcChannel::RefreshRoutes(const std::string& service_name) {
+    std::lock_guard<std::mutex> lock(routes_mutex_);
+    std::shared_ptr<const RouteTable> current = std::atomic_load(&routes_);
+    bool routed = std::any_of(current->begin(), current->end(), [&service_name](const auto& route) {
+        return route.first->service()->name() == service_name;
+    });
+    if (!routed) {
+        return;
     }
 
-    return address;
+    try {
+        auto table = std::make_shared<RouteTable>(*current);
+        for (auto it = table->begin(); it != table->end();) {
+            if (it->first->service()->name() != service_name) {
+                ++it;
+                continue;
+            }
+            std::shared_ptr<const InstanceList> instances =
+                zk_client_->FindInstancesByMethod(service_name, it->first->name());
+            if (instances->empty()) {
+                // 移除路由，之后的调用回到 ResolveRoute 并报告找不到实例
+                it = table->erase(it);
+                continue;
+            }
+            if (!SameInstances(it->second->Endpoints(), *instances)) {
+                it->second = BuildBalancer(service_name, *instances);
+            }
+            ++it;
+        }
+        std::atomic_store(&routes_, std::shared_ptr<const RouteTable>(std::move(table)));
+    } catch (const std::exception& e) {
+        // 注册中心暂不可用时保留原路由
+        XRPC_LOG_WARN("Failed to refresh routes for service {}: {}", service_name, e.what());
+    }
 }
 
-bool XrpcChannel::SendRequest(const std::string& data, std::string& response) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    bool success = transport_->Send(data, response);
-    if (!success) {
-        XRPC_LOG_ERROR("Failed to send request");
+bool XrpcChannel::SameInstances(const EndpointList& endpoints, const InstanceList& instances) {
+    if (endpoints.size() != instances.size()) {
         return false;
     }
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        if (endpoints[i]->address != instances[i]->address || endpoints[i]->weight != instances[i]->weight) {
+            return false;
+        }
+    }
     return true;
 }
 
-void XrpcChannel::SendRequestAsync(const std::string& data,
+std::shared_ptr<const LoadBalancer> XrpcChannel::BuildBalancer(const std::string& service_name,
+                                                               const InstanceList& instances) {
+    // 实例已由注册中心按地址排序，各客户端的 Maglev 表一致
+    // 同一地址复用原有的 Endpoint，保留在途调用数和延迟统计
+    EndpointList endpoints;
+    for (const auto& instance : instances) {
+        const InstanceInfo& info = *instance;
+        size_t colon_pos = info.address.rfind(':');
+        if (colon_pos == std::string::npos) {
+            XRPC_LOG_ERROR("Invalid address format: {}", info.address);
+            continue;
+        }
+        auto& endpoint = endpoints_[info.address];
+        if (!endpoint) {
+            endpoint = std::make_shared<Endpoint>();
+            endpoint->address = info.address;
+            endpoint->ip = info.address.substr(0, colon_pos);
+            endpoint->port = std::stoi(info.address.substr(colon_pos + 1));
+            endpoint->pool = transport_->GetEndpointPool(endpoint->ip, endpoint->port);
+        }
+        endpoint->weight = info.weight;
+        endpoints.push_back(endpoint);
+    }
+    if (endpoints.empty()) {
+        throw std::runtime_error("Invalid address format");
+    }
+    std::string policy = config_.Get("load_balancer." + service_name, config_.Get("load_balancer", "round_robin"));
+    XRPC_LOG_INFO("Service {} uses {} over {} instance(s)", service_name, policy, endpoints.size());
+    return LoadBalancer::Create(policy, std::move(endpoints));
+}
+
+void XrpcChannel::FinishEndpointCall(Endpoint& endpoint, std::chrono::steady_clock::time_point start,
+                                     CallStatus status) {
+    endpoint.inflight.fetch_sub(1, std::memory_order_relaxed);
+    // 连接失败和取消的耗时不代表实例的处理速度，不计入延迟
+    if (status == CallStatus::OK || status == CallStatus::TIMEOUT) {
+        endpoint.RecordLatency(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+CallStatus XrpcChannel::SendRequest(const std::shared_ptr<Endpoint>& endpoint, uint64_t request_id,
+                                    std::string frame, std::string& response, std::chrono::milliseconds timeout) {
+    // 不加锁，多个线程共享同一个 channel 时各自的同步调用并行进行
+    endpoint->inflight.fetch_add(1, std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    CallStatus status = transport_->SendFrame(endpoint->pool, request_id, std::move(frame), response, timeout);
+    FinishEndpointCall(*endpoint, start, status);
+    if (status != CallStatus::OK) {
+        XRPC_LOG_ERROR("Failed to send request");
+    }
+    return status;
+}
+
+void XrpcChannel::SendRequestAsync(std::shared_ptr<Endpoint> endpoint,
+                                  uint64_t request_id,
+                                  std::string frame,
+                                  std::chrono::milliseconds timeout,
                                   google::protobuf::RpcController* controller,
                                   google::protobuf::Message* response,
                                   google::protobuf::Closure* done) {
-    std::lock_guard<std::mutex> lock(mutex_);
     XrpcController* xrpc_controller = dynamic_cast<XrpcController*>(controller);
     if (!xrpc_controller) {
         XRPC_LOG_ERROR("Invalid controller type");
@@ -67,8 +177,22 @@ void XrpcChannel::SendRequestAsync(const std::string& data,
         return;
     }
 
-    transport_->SendAsync(data, [this, xrpc_controller, response, done](const std::string& response_data, bool success) {
-        if (!success) {
+    endpoint->inflight.fetch_add(1, std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    transport_->SendFrameAsync(endpoint->pool, request_id, std::move(frame), [this, endpoint, start, xrpc_controller, response, done](const std::string& response_data, CallStatus status) {
+        FinishEndpointCall(*endpoint, start, status);
+        xrpc_controller->SetCancelHandler(nullptr);
+        if (status == CallStatus::CANCELLED) {
+            xrpc_controller->SetFailed(ErrorCode::CANCELLED, "Request was canceled");
+            if (done) done->Run();
+            return;
+        }
+        if (status == CallStatus::TIMEOUT) {
+            xrpc_controller->SetFailed(ErrorCode::TIMEOUT, "Request timed out");
+            if (done) done->Run();
+            return;
+        }
+        if (status != CallStatus::OK) {
             xrpc_controller->SetFailed("Failed to send async request");
             XRPC_LOG_ERROR("Failed to send async request");
             if (done) done->Run();
@@ -99,7 +223,7 @@ void XrpcChannel::SendRequestAsync(const std::string& data,
 
         XRPC_LOG_INFO("Async request completed successfully");
         if (done) done->Run();
-    });
+    }, timeout);
 }
 
 void XrpcChannel::CallMethod(const google::protobuf::MethodDescriptor* method,
@@ -109,48 +233,88 @@ void XrpcChannel::CallMethod(const google::protobuf::MethodDescriptor* method,
                             google::protobuf::Closure* done) {
     try {
         // 获取服务和方法名
-        std::string service_name = method->service()->name();
-        std::string method_name = method->name();
+        const std::string& service_name = method->service()->name();
+        const std::string& method_name = method->name();
 
-        // 获取服务地址并连接
-        std::string address = GetServiceAddress(service_name, method_name);
-        size_t colon_pos = address.find(':');
-        std::string server_ip = address.substr(0, colon_pos);
-        int server_port = std::stoi(address.substr(colon_pos + 1));
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            transport_->Connect(server_ip, server_port);
-        }
+        uint64_t request_id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+        XrpcController* xrpc_controller = dynamic_cast<XrpcController*>(controller);
+
+        // 按该服务配置的负载均衡策略选择实例，连接由传输层按地址从连接池中取得
+        uint64_t request_key = xrpc_controller && xrpc_controller->HasRequestKey() ? xrpc_controller->RequestKey()
+                                                                                  : request_id;
+        std::shared_ptr<Endpoint> endpoint = SelectEndpoint(method, request_key);
 
         // 构造 RpcHeader
         RpcHeader header;
         header.set_service_name(service_name);
         header.set_method_name(method_name);
-        header.set_request_id(rand()); // 简单生成请求 ID
+        header.set_request_id(request_id);
         header.set_compressed(false); // 默认不压缩
         header.set_cancelled(false);
 
         // 检查是否已取消
-        XrpcController* xrpc_controller = dynamic_cast<XrpcController*>(controller);
         if (xrpc_controller && xrpc_controller->IsCanceled()) {
-            xrpc_controller->SetFailed("Request was canceled before sending");
+            xrpc_controller->SetFailed(ErrorCode::CANCELLED, "Request was canceled before sending");
             XRPC_LOG_INFO("Request canceled before sending");
             if (done) done->Run();
             return;
         }
 
-        // 序列化请求
-        std::string data = codec_.Encode(header, *request);
+        // 超时由传输层的时间轮执行，到期后移除未完成请求
+        std::chrono::milliseconds timeout(xrpc_controller ? xrpc_controller->Timeout() : 0);
+        if (xrpc_controller && xrpc_controller->HasDeadline()) {
+            // 继承自上游的截止时间，取与本次超时中较早者
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                xrpc_controller->Deadline() - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                xrpc_controller->SetFailed(ErrorCode::TIMEOUT, "Deadline exceeded before sending");
+                if (done) done->Run();
+                return;
+            }
+            if (timeout.count() == 0 || remaining < timeout) {
+                timeout = remaining;
+            }
+        }
+        if (timeout.count() > 0) {
+            // 携带剩余时间而不是绝对时间，不依赖两端时钟同步
+            (*header.mutable_metadata())[kTimeoutMetadataKey] = std::to_string(timeout.count());
+        }
+
+        // 序列化请求，开头为传输层帧头预留空间，编码结果直接移交给发送队列
+        std::string frame = codec_.Encode(header, *request, FrameBuffer::kHeaderSize);
+
+        if (xrpc_controller) {
+            // 调用期间 StartCancel 会移除未完成请求并向服务端发送 CANCEL 帧，调用结束时清除
+            xrpc_controller->SetCancelHandler([this, request_id]() { transport_->CancelCall(request_id); });
+            if (xrpc_controller->IsCanceled()) { // 在检查之后、设置之前被取消
+                xrpc_controller->SetCancelHandler(nullptr);
+                xrpc_controller->SetFailed(ErrorCode::CANCELLED, "Request was canceled before sending");
+                if (done) done->Run();
+                return;
+            }
+        }
 
         // 异步调用
         if (done) {
-            SendRequestAsync(data, controller, response, done);
+            SendRequestAsync(endpoint, request_id, std::move(frame), timeout, controller, response, done);
             return;
         }
 
         // 同步调用
         std::string response_data;
-        if (!SendRequest(data, response_data)) {
+        CallStatus status = SendRequest(endpoint, request_id, std::move(frame), response_data, timeout);
+        if (xrpc_controller) {
+            xrpc_controller->SetCancelHandler(nullptr);
+        }
+        if (status == CallStatus::CANCELLED) {
+            xrpc_controller->SetFailed(ErrorCode::CANCELLED, "Request was canceled");
+            return;
+        }
+        if (status == CallStatus::TIMEOUT) {
+            xrpc_controller->SetFailed(ErrorCode::TIMEOUT, "Request timed out");
+            return;
+        }
+        if (status != CallStatus::OK) {
             controller->SetFailed("Failed to send request");
             if (done) done->Run();
             return;
@@ -174,6 +338,9 @@ void XrpcChannel::CallMethod(const google::protobuf::MethodDescriptor* method,
         if (done) done->Run();
     } catch (const std::exception& e) {
         XRPC_LOG_ERROR("CallMethod failed: {}", e.what());
+        if (XrpcController* xrpc_controller = dynamic_cast<XrpcController*>(controller)) {
+            xrpc_controller->SetCancelHandler(nullptr);
+        }
         controller->SetFailed(e.what());
         if (done) done->Run();
     }
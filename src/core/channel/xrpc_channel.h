@@ -4,12 +4,19 @@
 #include "core/common/xrpc_common.h"
 #include "core/common/xrpc_config.h"
 #include "core/codec/xrpc_codec.h"
+#include "core/channel/xrpc_future.h"
+#include "core/channel/load_balancer.h"
 #include "registry/zookeeper_client.h"
+#include "registry/service_instance.h"
 #include "transport/asio_transport.h"
 #include <google/protobuf/service.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
-#include <string>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace xrpc {
 
@@ -25,18 +32,48 @@ public:
                    google::protobuf::Message* response,
                    google::protobuf::Closure* done) override;
 
+    // 异步调用并返回 future，结果在传输层线程上直接完成；request 在返回前已编码，调用方无需保留
+    // auto f = channel.CallAsync<example::LoginResponse>(example::UserService::descriptor()->FindMethodByName("Login"), req);
+    // timeout_ms 非 0 时超时以 ErrorCode::TIMEOUT 失败
+    template <typename Response>
+    XrpcFuture<Response> CallAsync(const google::protobuf::MethodDescriptor* method,
+                                   const google::protobuf::Message& request, int64_t timeout_ms = 0) {
+        auto state = std::make_shared<detail::CallState<Response>>();
+        state->self = state;
+        state->controller.SetTimeout(timeout_ms);
+        CallMethod(method, &state->controller, &request, &state->value, state.get());
+        return XrpcFuture<Response>(state);
+    }
+
 private:
     // 初始化 ZooKeeper
     void Init();
 
-    // 获取服务地址
-    std::string GetServiceAddress(const std::string& service_name, const std::string& method_name);
+    // 方法到负载均衡器的路由表，发布后只读；以方法描述符为键，查找时不构造字符串
+    using RouteTable = std::unordered_map<const google::protobuf::MethodDescriptor*,
+                                          std::shared_ptr<const LoadBalancer>>;
+
+    // 按负载均衡策略选择提供该方法的实例：命中路由表时只读取一次路由表指针并 Select，不争用 routes_mutex_、不解析
+    std::shared_ptr<Endpoint> SelectEndpoint(const google::protobuf::MethodDescriptor* method, uint64_t request_key);
+    // 路由表未命中：从注册中心解析该方法的实例并发布新路由表
+    std::shared_ptr<const LoadBalancer> ResolveRoute(const google::protobuf::MethodDescriptor* method);
+    // 注册中心通知服务实例变化：重建该服务已有的路由，实例未变的路由保持原均衡器
+    void RefreshRoutes(const std::string& service_name);
+    static bool SameInstances(const EndpointList& endpoints, const InstanceList& instances);
+    // 调用方持有 routes_mutex_
+    std::shared_ptr<const LoadBalancer> BuildBalancer(const std::string& service_name, const InstanceList& instances);
+    // 调用结束：归还实例的在途计数并记录延迟
+    static void FinishEndpointCall(Endpoint& endpoint, std::chrono::steady_clock::time_point start, CallStatus status);
 
     // 发送请求并接收响应（同步）
-    bool SendRequest(const std::string& data, std::string& response);
+    CallStatus SendRequest(const std::shared_ptr<Endpoint>& endpoint, uint64_t request_id,
+                           std::string frame, std::string& response, std::chrono::milliseconds timeout);
 
     // 发送请求并接收响应（异步）
-    void SendRequestAsync(const std::string& data,
+    void SendRequestAsync(std::shared_ptr<Endpoint> endpoint,
+                         uint64_t request_id,
+                         std::string frame,
+                         std::chrono::milliseconds timeout,
                          google::protobuf::RpcController* controller,
                          google::protobuf::Message* response,
                          google::protobuf::Closure* done);
@@ -45,7 +82,11 @@ private:
     XrpcCodec codec_;
     std::unique_ptr<ZookeeperClient> zk_client_;
     std::unique_ptr<AsioTransport> transport_;
-    std::mutex mutex_;
+    std::atomic<uint64_t> next_request_id_; // 单调递增，用于在连接上匹配响应
+    // 通过 std::atomic_load/atomic_store 访问，见 docs/design.md“并发”
+    std::shared_ptr<const RouteTable> routes_;
+    std::mutex routes_mutex_; // 串行化路由表的重建，保护 endpoints_
+    std::unordered_map<std::string, std::shared_ptr<Endpoint>> endpoints_; // key 为 ip:port
 };
 
 } // namespace xrpc
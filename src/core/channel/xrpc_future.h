@@ -0,0 +1,212 @@
+#ifndef XRPC_FUTURE_H
+#define XRPC_FUTURE_H
+
+#include "core/controller/xrpc_controller.h"
+#include <google/protobuf/service.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xrpc {
+
+template <typename T>
+class XrpcFuture;
+
+namespace detail {
+
+// future 与 promise 共享的结果状态，结果只设置一次
+template <typename T>
+struct FutureState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool ready = false;
+    bool failed = false;
+    std::string error_text;
+    T value{};
+    std::vector<std::function<void()>> callbacks;
+
+    // 在设置结果的线程上直接执行已注册的回调
+    void Finish(bool is_failed, std::string error) {
+        std::vector<std::function<void()>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready) {
+                return;
+            }
+            failed = is_failed;
+            error_text = std::move(error);
+            ready = true;
+            pending.swap(callbacks);
+        }
+        cv.notify_all();
+        for (auto& callback : pending) {
+            callback();
+        }
+    }
+
+    // 已完成时在当前线程立即执行
+    void OnReady(std::function<void()> callback) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ready) {
+                callbacks.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+};
+
+// XrpcChannel::CallAsync 的调用状态：自身作为 done 传给 CallMethod，响应直接写入 value
+template <typename Response>
+struct CallState : FutureState<Response>, google::protobuf::Closure {
+    void Run() override {
+        std::shared_ptr<CallState> keep_alive = std::move(self);
+        this->Finish(controller.Failed(), controller.ErrorText());
+    }
+
+    XrpcController controller;
+    std::shared_ptr<CallState> self; // 调用完成前保持存活
+};
+
+} // namespace detail
+
+// 异步结果：可在任意线程等待或注册回调；回调在完成结果的线程上执行（对 RPC 调用即传输层线程）
+template <typename T>
+class XrpcFuture {
+public:
+    XrpcFuture() = default;
+    explicit XrpcFuture(std::shared_ptr<detail::FutureState<T>> state) : state_(std::move(state)) {}
+
+    bool Valid() const { return state_ != nullptr; }
+
+    bool Ready() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->ready;
+    }
+
+    // 等待完成，超时返回 false
+    bool Wait(std::chrono::milliseconds timeout) const {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        return state_->cv.wait_for(lock, timeout, [this] { return state_->ready; });
+    }
+
+    // 阻塞直到完成；失败时返回的值为默认值或部分结果，需先检查 Failed()
+    const T& Get() const {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->cv.wait(lock, [this] { return state_->ready; });
+        return state_->value;
+    }
+
+    // 超时返回 nullptr
+    const T* Get(std::chrono::milliseconds timeout) const {
+        return Wait(timeout) ? &state_->value : nullptr;
+    }
+
+    // 以下两项只在完成后有意义
+    bool Failed() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->failed;
+    }
+
+    std::string ErrorText() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->error_text;
+    }
+
+    // 完成后调用 fn(future)；fn 返回值时得到新的 future，fn 返回 void 时 Then 也返回 void
+    template <typename F>
+    auto Then(F fn) const {
+        using Result = std::invoke_result_t<F, const XrpcFuture<T>&>;
+        XrpcFuture<T> self = *this;
+        if constexpr (std::is_void_v<Result>) {
+            state_->OnReady([self, fn = std::move(fn)]() mutable { fn(self); });
+        } else {
+            auto next = std::make_shared<detail::FutureState<Result>>();
+            state_->OnReady([self, next, fn = std::move(fn)]() mutable {
+                next->value = fn(self);
+                next->Finish(false, std::string());
+            });
+            return XrpcFuture<Result>(next);
+        }
+    }
+
+private:
+    std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+// 手动完成的 future，用于把其他异步操作接入 XrpcFuture
+template <typename T>
+class XrpcPromise {
+public:
+    XrpcPromise() : state_(std::make_shared<detail::FutureState<T>>()) {}
+
+    XrpcFuture<T> GetFuture() const { return XrpcFuture<T>(state_); }
+
+    void SetValue(T value) {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (state_->ready) {
+                return;
+            }
+            state_->value = std::move(value);
+        }
+        state_->Finish(false, std::string());
+    }
+
+    void SetFailed(const std::string& reason) { state_->Finish(true, reason); }
+
+private:
+    std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+// 所有 future 完成（无论成功失败）后完成，结果为传入的 future 列表
+template <typename T>
+XrpcFuture<std::vector<XrpcFuture<T>>> WhenAll(std::vector<XrpcFuture<T>> futures) {
+    auto result = std::make_shared<detail::FutureState<std::vector<XrpcFuture<T>>>>();
+    if (futures.empty()) {
+        result->Finish(false, std::string());
+        return XrpcFuture<std::vector<XrpcFuture<T>>>(result);
+    }
+    auto remaining = std::make_shared<std::atomic<size_t>>(futures.size());
+    result->value = futures;
+    for (const auto& future : futures) {
+        future.Then([result, remaining](const XrpcFuture<T>&) {
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                result->Finish(false, std::string());
+            }
+        });
+    }
+    return XrpcFuture<std::vector<XrpcFuture<T>>>(result);
+}
+
+// 任意一个 future 完成时完成，结果为它在列表中的下标；列表为空时以失败完成
+template <typename T>
+XrpcFuture<size_t> WhenAny(const std::vector<XrpcFuture<T>>& futures) {
+    auto result = std::make_shared<detail::FutureState<size_t>>();
+    if (futures.empty()) {
+        result->Finish(true, "WhenAny on empty list");
+        return XrpcFuture<size_t>(result);
+    }
+    auto claimed = std::make_shared<std::atomic<bool>>(false);
+    for (size_t i = 0; i < futures.size(); ++i) {
+        futures[i].Then([result, claimed, i](const XrpcFuture<T>&) {
+            if (!claimed->exchange(true, std::memory_order_acq_rel)) {
+                result->value = i;
+                result->Finish(false, std::string());
+            }
+        });
+    }
+    return XrpcFuture<size_t>(result);
+}
+
+} // namespace xrpc
+
+#endif // XRPC_FUTURE_H
@@ -1,84 +1,73 @@
 #include "core/codec/xrpc_codec.h"
 #include "core/common/xrpc_logger.h"
 #include <google/protobuf/io/coded_stream.h>
-#include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <zlib.h>
+#include <cstring>
 #include <stdexcept>
 
 namespace xrpc {
 
-std::string XrpcCodec::Encode(const RpcHeader& header, const google::protobuf::Message& args) {
-    std::string args_str;
-    if (!args.SerializeToString(&args_str)) {
-        XRPC_LOG_ERROR("Failed to serialize args");
-        throw std::runtime_error("Failed to serialize args");
+std::string XrpcCodec::Encode(const RpcHeader& header, const google::protobuf::Message& args, size_t headroom) {
+    return EncodeMessage(header, args, headroom);
+}
+
+std::string XrpcCodec::EncodeMessage(const RpcHeader& header, const google::protobuf::Message& body, size_t headroom) {
+    if (!body.IsInitialized()) {
+        XRPC_LOG_ERROR("Failed to serialize {}", body.GetTypeName());
+        throw std::runtime_error("Failed to serialize " + body.GetTypeName());
     }
+    // ByteSizeLong 同时缓存各字段大小，后续 SerializeWithCachedSizesToArray 直接写入目标缓冲区
+    size_t body_size = body.ByteSizeLong();
 
     // 更新 args_size 和压缩状态
     RpcHeader mutable_header = header;
-    mutable_header.set_args_size(args_str.size());
-
-    if (mutable_header.compressed() && args_str.size() > 100) { // 跳过小数据压缩
-        std::string compressed_args = Compress(args_str);
-        if (compressed_args.size() < args_str.size()) { // 仅当压缩有效时使用
-            XRPC_LOG_DEBUG("Compressed args from {} to {} bytes", args_str.size(), compressed_args.size());
-            mutable_header.set_args_size(compressed_args.size());
-            args_str = compressed_args;
+    mutable_header.set_args_size(body_size);
+
+    std::string compressed_body;
+    if (mutable_header.compressed() && body_size > 100) { // 跳过小数据压缩
+        // 压缩需要完整的原始数据，这条路径仍会多一次序列化
+        compressed_body = Compress(body.SerializeAsString());
+        if (compressed_body.size() < body_size) { // 仅当压缩有效时使用
+            XRPC_LOG_DEBUG("Compressed body from {} to {} bytes", body_size, compressed_body.size());
+            mutable_header.set_args_size(compressed_body.size());
         } else {
             mutable_header.set_compressed(false); // 压缩无效，关闭标志
-            XRPC_LOG_DEBUG("Skipped compression: compressed size {} >= original size {}", 
-                           compressed_args.size(), args_str.size());
+            XRPC_LOG_DEBUG("Skipped compression: compressed size {} >= original size {}",
+                           compressed_body.size(), body_size);
+            compressed_body.clear();
         }
     } else if (mutable_header.compressed()) {
         mutable_header.set_compressed(false); // 数据太小，禁用压缩
-        XRPC_LOG_DEBUG("Skipped compression: data size {} too small", args_str.size());
+        XRPC_LOG_DEBUG("Skipped compression: data size {} too small", body_size);
     }
 
-    std::string header_str;
-    if (!mutable_header.SerializeToString(&header_str)) {
-        XRPC_LOG_ERROR("Failed to serialize RpcHeader");
-        throw std::runtime_error("Failed to serialize RpcHeader");
+    // 预先算出总长度，header 与 body 直接序列化进同一块缓冲区
+    size_t header_size = mutable_header.ByteSizeLong();
+    size_t payload_size = mutable_header.compressed() ? compressed_body.size() : body_size;
+    size_t varint_size = google::protobuf::io::CodedOutputStream::VarintSize32(static_cast<uint32_t>(header_size));
+    std::string result(headroom + varint_size + header_size + payload_size, '\0');
+
+    uint8_t* target = reinterpret_cast<uint8_t*>(&result[headroom]);
+    target = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(header_size), target);
+    target = mutable_header.SerializeWithCachedSizesToArray(target);
+    if (mutable_header.compressed()) {
+        std::memcpy(target, compressed_body.data(), compressed_body.size());
+    } else {
+        body.SerializeWithCachedSizesToArray(target);
     }
 
-    std::string result;
-    google::protobuf::io::StringOutputStream output(&result);
-    google::protobuf::io::CodedOutputStream coded_output(&output);
-    coded_output.WriteVarint32(header_str.size());
-    coded_output.WriteString(header_str);
-    coded_output.WriteString(args_str);
-
-    XRPC_LOG_DEBUG("Encoded data: header_size={}, header_bytes={}, args_bytes={}",
-                   header_str.size(), header_str.size(), args_str.size());
+    XRPC_LOG_DEBUG("Encoded data: header_bytes={}, body_bytes={}, headroom={}", header_size, payload_size, headroom);
     return result;
 }
 
 bool XrpcCodec::Decode(const std::string& data, RpcHeader& header, std::string& args) {
-    google::protobuf::io::ArrayInputStream input(data.data(), data.size());
-    google::protobuf::io::CodedInputStream coded_input(&input);
-
-    uint32_t header_size = 0;
-    if (!coded_input.ReadVarint32(&header_size)) {
-        XRPC_LOG_ERROR("Failed to read header size");
-        return false;
-    }
-
-    std::string header_str;
-    if (!coded_input.ReadString(&header_str, header_size)) {
-        XRPC_LOG_ERROR("Failed to read header");
-        return false;
-    }
-
-    if (!header.ParseFromString(header_str)) {
-        XRPC_LOG_ERROR("Failed to parse RpcHeader");
-        return false;
-    }
-
-    args.clear();
-    if (!coded_input.ReadString(&args, header.args_size())) {
-        XRPC_LOG_ERROR("Failed to read args, expected size: {}", header.args_size());
+    const char* body = nullptr;
+    size_t body_size = 0;
+    if (!DecodeHeader(data.data(), data.size(), header, &body, &body_size)) {
         return false;
     }
 
+    args.assign(body, body_size);
     if (header.compressed()) {
         try {
             args = Decompress(args);
@@ -89,56 +78,13 @@ bool XrpcCodec::Decode(const std::string& data, RpcHeader& header, std::string&
         }
     }
 
-    XRPC_LOG_DEBUG("Decoded data: header_size={}, args_size={}, compressed={}",
-                   header_size, args.size(), header.compressed());
+    XRPC_LOG_DEBUG("Decoded data: args_size={}, compressed={}", args.size(), header.compressed());
     return true;
 }
 
-std::string XrpcCodec::EncodeResponse(const RpcHeader& header, const google::protobuf::Message& response) {
-    std::string response_str;
-    if (!response.SerializeToString(&response_str)) {
-        XRPC_LOG_ERROR("Failed to serialize response");
-        throw std::runtime_error("Failed to serialize response");
-    }
-
-    RpcHeader mutable_header = header;
-    mutable_header.set_args_size(response_str.size());
-    if (mutable_header.compressed() && response_str.size() > 100) {
-        std::string compressed_response = Compress(response_str);
-        if (compressed_response.size() < response_str.size()) {
-            XRPC_LOG_DEBUG("Compressed response from {} to {} bytes", response_str.size(), compressed_response.size());
-            mutable_header.set_args_size(compressed_response.size());
-            response_str = compressed_response;
-        } else {
-            mutable_header.set_compressed(false);
-            XRPC_LOG_DEBUG("Skipped compression: compressed size {} >= original size {}", 
-                           compressed_response.size(), response_str.size());
-        }
-    } else if (mutable_header.compressed()) {
-        mutable_header.set_compressed(false);
-        XRPC_LOG_DEBUG("Skipped compression: data size {} too small", response_str.size());
-    }
-
-    std::string header_str;
-    if (!mutable_header.SerializeToString(&header_str)) {
-        XRPC_LOG_ERROR("Failed to serialize RpcHeader");
-        throw std::runtime_error("Failed to serialize RpcHeader");
-    }
-
-    std::string result;
-    google::protobuf::io::StringOutputStream output(&result);
-    google::protobuf::io::CodedOutputStream coded_output(&output);
-    coded_output.WriteVarint32(header_str.size());
-    coded_output.WriteString(header_str);
-    coded_output.WriteString(response_str);
-
-    XRPC_LOG_DEBUG("Encoded response: header_size={}, response_bytes={}", header_str.size(), response_str.size());
-    return result;
-}
-
-bool XrpcCodec::DecodeResponse(const std::string& data, RpcHeader& header, google::protobuf::Message& response) {
-    google::protobuf::io::ArrayInputStream input(data.data(), data.size());
-    google::protobuf::io::CodedInputStream coded_input(&input);
+bool XrpcCodec::DecodeHeader(const char* data, size_t size, RpcHeader& header,
+                             const char** body, size_t* body_size) {
+    google::protobuf::io::CodedInputStream coded_input(reinterpret_cast<const uint8_t*>(data), static_cast<int>(size));
 
     uint32_t header_size = 0;
     if (!coded_input.ReadVarint32(&header_size)) {
@@ -146,40 +92,62 @@ bool XrpcCodec::DecodeResponse(const std::string& data, RpcHeader& header, googl
         return false;
     }
 
-    std::string header_str;
-    if (!coded_input.ReadString(&header_str, header_size)) {
+    size_t offset = coded_input.CurrentPosition();
+    if (header_size > size - offset) {
         XRPC_LOG_ERROR("Failed to read header");
         return false;
     }
 
-    if (!header.ParseFromString(header_str)) {
+    // 直接在输入缓冲区上解析，不复制头部
+    if (!header.ParseFromArray(data + offset, static_cast<int>(header_size))) {
         XRPC_LOG_ERROR("Failed to parse RpcHeader");
         return false;
     }
+    offset += header_size;
 
-    std::string response_str;
-    if (!coded_input.ReadString(&response_str, header.args_size())) {
-        XRPC_LOG_ERROR("Failed to read response, expected size: {}", header.args_size());
+    if (header.args_size() > size - offset) {
+        XRPC_LOG_ERROR("Failed to read args, expected size: {}", header.args_size());
         return false;
     }
+    *body = data + offset;
+    *body_size = header.args_size();
+    return true;
+}
 
+bool XrpcCodec::ParseBody(const RpcHeader& header, const char* body, size_t body_size,
+                          google::protobuf::Message& message) {
     if (header.compressed()) {
+        std::string decompressed;
         try {
-            response_str = Decompress(response_str);
-            XRPC_LOG_DEBUG("Decompressed response to {} bytes", response_str.size());
+            decompressed = Decompress(std::string(body, body_size));
+            XRPC_LOG_DEBUG("Decompressed body to {} bytes", decompressed.size());
         } catch (const std::runtime_error& e) {
             XRPC_LOG_ERROR("Decompression failed: {}", e.what());
             return false;
         }
+        return message.ParseFromString(decompressed);
+    }
+    return message.ParseFromArray(body, static_cast<int>(body_size));
+}
+
+std::string XrpcCodec::EncodeResponse(const RpcHeader& header, const google::protobuf::Message& response,
+                                      size_t headroom) {
+    return EncodeMessage(header, response, headroom);
+}
+
+bool XrpcCodec::DecodeResponse(const std::string& data, RpcHeader& header, google::protobuf::Message& response) {
+    const char* body = nullptr;
+    size_t body_size = 0;
+    if (!DecodeHeader(data.data(), data.size(), header, &body, &body_size)) {
+        return false;
     }
 
-    if (!response.ParseFromString(response_str)) {
+    if (!ParseBody(header, body, body_size, response)) {
         XRPC_LOG_ERROR("Failed to parse response");
         return false;
     }
 
-    XRPC_LOG_DEBUG("Decoded response: header_size={}, response_size={}, compressed={}",
-                   header_size, response_str.size(), header.compressed());
+    XRPC_LOG_DEBUG("Decoded response: response_size={}, compressed={}", body_size, header.compressed());
     return true;
 }
 
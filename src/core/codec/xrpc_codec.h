@@ -19,18 +19,29 @@ namespace xrpc {
 class XrpcCodec {
 public:
     // 编码请求：header + args
-    std::string Encode(const RpcHeader& header, const google::protobuf::Message& args);
+    // headroom 为结果开头预留的字节数（例如传输层帧头），编码只做一次内存分配
+    std::string Encode(const RpcHeader& header, const google::protobuf::Message& args, size_t headroom = 0);
 
     // 解码请求：返回 header 和 args
     bool Decode(const std::string& data, RpcHeader& header, std::string& args);
 
+    // 只解析头部，body 指向 data 内部的消息体（可能是压缩数据），不做复制
+    bool DecodeHeader(const char* data, size_t size, RpcHeader& header, const char** body, size_t* body_size);
+
+    // 从 DecodeHeader 得到的消息体解析 message，必要时先解压
+    bool ParseBody(const RpcHeader& header, const char* body, size_t body_size, google::protobuf::Message& message);
+
     // 编码响应：header + response
-    std::string EncodeResponse(const RpcHeader& header, const google::protobuf::Message& response);
+    std::string EncodeResponse(const RpcHeader& header, const google::protobuf::Message& response,
+                               size_t headroom = 0);
 
     // 解码响应：返回 header 和 response
     bool DecodeResponse(const std::string& data, RpcHeader& header, google::protobuf::Message& response);
 
 private:
+    // 按 ByteSizeLong 预先确定长度，把 header 和 body 直接序列化进一块缓冲区
+    std::string EncodeMessage(const RpcHeader& header, const google::protobuf::Message& body, size_t headroom);
+
     // 压缩和解压缩
     std::string Compress(const std::string& data);
     std::string Decompress(const std::string& data);
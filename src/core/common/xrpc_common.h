@@ -23,6 +23,9 @@ enum class ErrorCode {
     CANCELLED = 5
 };
 
+// RpcHeader.metadata 中携带调用剩余时间（毫秒）的键，服务端据此换算本地截止时间
+constexpr const char kTimeoutMetadataKey[] = "timeout_ms";
+
 } // namespace xrpc
 
 #endif // XRPC_COMMON_H
\ No newline at end of file
@@ -4,21 +4,36 @@
 
 namespace xrpc {
 
-XrpcController::XrpcController() : failed_(false), canceled_(false), cancel_callback_(nullptr) {}
+XrpcController::XrpcController()
+    : failed_(false), error_code_(ErrorCode::OK), timeout_ms_(0),
+      deadline_(std::chrono::steady_clock::time_point::max()), has_request_key_(false), request_key_(0),
+      canceled_(false), cancel_callback_(nullptr) {}
 
 XrpcController::~XrpcController() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (cancel_callback_ && !canceled_) {
-        cancel_callback_->Run();
+    google::protobuf::Closure* callback = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!canceled_) {
+            callback = cancel_callback_;
+        }
+    }
+    if (callback) {
+        callback->Run();
     }
 }
 
 void XrpcController::Reset() {
     std::lock_guard<std::mutex> lock(mutex_);
     failed_ = false;
+    error_code_ = ErrorCode::OK;
     error_text_.clear();
+    timeout_ms_ = 0;
+    deadline_ = std::chrono::steady_clock::time_point::max();
+    has_request_key_ = false;
+    request_key_ = 0;
     canceled_ = false;
     cancel_callback_ = nullptr;
+    cancel_handler_ = nullptr;
 }
 
 bool XrpcController::Failed() const {
@@ -32,22 +47,83 @@ std::string XrpcController::ErrorText() const {
 }
 
 void XrpcController::SetFailed(const std::string& reason) {
+    SetFailed(ErrorCode::SERVER_ERROR, reason);
+}
+
+void XrpcController::SetFailed(ErrorCode code, const std::string& reason) {
     std::lock_guard<std::mutex> lock(mutex_);
     failed_ = true;
+    error_code_ = code;
     error_text_ = reason;
     XRPC_LOG_ERROR("Request failed: {}", reason);
 }
 
-void XrpcController::StartCancel() {
+ErrorCode XrpcController::GetErrorCode() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (canceled_) {
-        return;
-    }
-    canceled_ = true;
-    XRPC_LOG_INFO("Request canceled");
-    if (cancel_callback_) {
-        cancel_callback_->Run();
+    return error_code_;
+}
+
+void XrpcController::SetTimeout(int64_t timeout_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeout_ms_ = timeout_ms > 0 ? timeout_ms : 0;
+}
+
+int64_t XrpcController::Timeout() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timeout_ms_;
+}
+
+void XrpcController::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_ = deadline;
+}
+
+std::chrono::steady_clock::time_point XrpcController::Deadline() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deadline_;
+}
+
+bool XrpcController::HasDeadline() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deadline_ != std::chrono::steady_clock::time_point::max();
+}
+
+void XrpcController::SetRequestKey(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_request_key_ = true;
+    request_key_ = key;
+}
+
+bool XrpcController::HasRequestKey() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return has_request_key_;
+}
+
+uint64_t XrpcController::RequestKey() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return request_key_;
+}
+
+void XrpcController::StartCancel() {
+    google::protobuf::Closure* callback = nullptr;
+    std::function<void()> handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (canceled_) {
+            return;
+        }
+        canceled_ = true;
+        XRPC_LOG_INFO("Request canceled");
+        callback = cancel_callback_;
         cancel_callback_ = nullptr;
+        handler.swap(cancel_handler_);
+    }
+    // 两者都可能回到本控制器上查询或设置失败状态（服务端的回调在 reactor 线程上与处理函数并发执行），不能持锁执行
+    if (callback) {
+        callback->Run();
+    }
+    if (handler) {
+        handler();
     }
 }
 
@@ -57,12 +133,21 @@ bool XrpcController::IsCanceled() const {
 }
 
 void XrpcController::NotifyOnCancel(google::protobuf::Closure* callback) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    cancel_callback_ = callback;
-    if (canceled_ && callback) {
-        callback->Run();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!canceled_ || !callback) {
+            cancel_callback_ = callback;
+            return;
+        }
         cancel_callback_ = nullptr;
     }
+    // 已取消时立即执行，同样不持锁
+    callback->Run();
+}
+
+void XrpcController::SetCancelHandler(std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancel_handler_ = std::move(handler);
 }
 
 } // namespace xrpc
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include "core/common/xrpc_common.h"
 #include <google/protobuf/service.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <mutex>
 
@@ -22,20 +25,48 @@ public:
     // 错误信息
     std::string ErrorText() const override;
 
-    // 设置失败
+    // 设置失败，错误码为 ErrorCode::SERVER_ERROR
     void SetFailed(const std::string& reason) override;
+    void SetFailed(ErrorCode code, const std::string& reason);
+
+    // 失败时的错误码，未失败时为 ErrorCode::OK
+    ErrorCode GetErrorCode() const;
+
+    // 客户端调用超时（毫秒），0 表示不限时；超时后调用以 ErrorCode::TIMEOUT 失败
+    void SetTimeout(int64_t timeout_ms);
+    int64_t Timeout() const;
+
+    // 调用截止时间，默认为 time_point::max() 表示不限时
+    // 服务端由请求头中的剩余时间换算得到；客户端设置后实际超时取它与 Timeout() 中较早者，用于向下游传递
+    void SetDeadline(std::chrono::steady_clock::time_point deadline);
+    std::chrono::steady_clock::time_point Deadline() const;
+    bool HasDeadline() const;
+
+    // 一致性哈希负载均衡使用的请求键，相同的键发往同一实例；未设置时按 request_id 分散
+    void SetRequestKey(uint64_t key);
+    bool HasRequestKey() const;
+    uint64_t RequestKey() const;
 
     // 取消相关
     void StartCancel() override;
     bool IsCanceled() const override;
     void NotifyOnCancel(google::protobuf::Closure* callback) override;
 
+    // 由 XrpcChannel 在调用期间设置，StartCancel 时在锁外执行一次以通知服务端；传入空函数清除
+    void SetCancelHandler(std::function<void()> handler);
+
 private:
     mutable std::mutex mutex_;
     bool failed_;
+    ErrorCode error_code_;
     std::string error_text_;
+    int64_t timeout_ms_;
+    std::chrono::steady_clock::time_point deadline_;
+    bool has_request_key_;
+    uint64_t request_key_;
     bool canceled_;
     google::protobuf::Closure* cancel_callback_;
+    std::function<void()> cancel_handler_;
 };
 
 } // namespace xrpc
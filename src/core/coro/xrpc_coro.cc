@@ -0,0 +1,59 @@
+#include "core/coro/xrpc_coro.h"
+
+#ifdef XRPC_HAS_COROUTINES
+
+#include <new>
+#include <vector>
+
+namespace xrpc {
+
+namespace {
+// 每个线程按大小分级缓存释放的协程帧，线程退出时归还给系统
+struct FrameCache {
+    ~FrameCache() {
+        for (auto& blocks : free_blocks) {
+            for (void* block : blocks) {
+                ::operator delete(block);
+            }
+        }
+    }
+    std::vector<void*> free_blocks[FramePool::kMaxPooledSize / FramePool::kSizeClass];
+};
+
+thread_local FrameCache frame_cache;
+
+size_t SizeClassIndex(size_t size) {
+    return (size + FramePool::kSizeClass - 1) / FramePool::kSizeClass - 1;
+}
+} // namespace
+
+void* FramePool::Allocate(size_t size) {
+    if (size == 0 || size > kMaxPooledSize) {
+        return ::operator new(size);
+    }
+    auto& blocks = frame_cache.free_blocks[SizeClassIndex(size)];
+    if (blocks.empty()) {
+        // 按分级上限分配，同一级别的帧可以互相复用
+        return ::operator new((SizeClassIndex(size) + 1) * kSizeClass);
+    }
+    void* block = blocks.back();
+    blocks.pop_back();
+    return block;
+}
+
+void FramePool::Deallocate(void* ptr, size_t size) {
+    if (size == 0 || size > kMaxPooledSize) {
+        ::operator delete(ptr);
+        return;
+    }
+    auto& blocks = frame_cache.free_blocks[SizeClassIndex(size)];
+    if (blocks.size() >= kMaxCachedPerClass) {
+        ::operator delete(ptr);
+        return;
+    }
+    blocks.push_back(ptr);
+}
+
+} // namespace xrpc
+
+#endif // XRPC_HAS_COROUTINES
@@ -0,0 +1,280 @@
+#ifndef XRPC_CORO_H
+#define XRPC_CORO_H
+
+// 可选的 C++20 协程接口，需要以 -DXRPC_ENABLE_COROUTINES=ON 构建
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define XRPC_HAS_COROUTINES 1
+#endif
+
+#ifdef XRPC_HAS_COROUTINES
+
+#include <google/protobuf/service.h>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace xrpc {
+
+// 协程帧内存池：按 64 字节分级的线程局部空闲链表，帧可在另一个线程释放，归还到释放线程的缓存
+class FramePool {
+public:
+    static void* Allocate(size_t size);
+    static void Deallocate(void* ptr, size_t size);
+
+    static constexpr size_t kSizeClass = 64;
+    static constexpr size_t kMaxPooledSize = 4096; // 更大的帧直接使用 operator new
+    static constexpr size_t kMaxCachedPerClass = 64;
+};
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+// 所有协程帧都从 FramePool 分配
+struct PooledFrame {
+    static void* operator new(size_t size) { return FramePool::Allocate(size); }
+    static void operator delete(void* ptr, size_t size) { FramePool::Deallocate(ptr, size); }
+};
+
+struct PromiseBase : PooledFrame {
+    // 结束时对称转移回等待者，不经过调度器
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    Task<T> get_return_object();
+    void return_value(T result) { value.emplace(std::move(result)); }
+    T Result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() const noexcept {}
+    void Result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+// 立即开始执行、结束时自行销毁的协程，用于 Spawn 和 SyncWait
+struct DetachedTask {
+    struct promise_type : PooledFrame {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+// 惰性协程：被 co_await 时才开始执行，完成后恢复等待者
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    auto operator co_await() const noexcept {
+        struct Awaiter {
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().Result(); }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+// 一次 RPC 调用的 awaiter：自身就是传给 stub 的 done，响应保存在协程帧内，调用过程不额外分配 Closure
+// 协程在传输层完成回调的线程上恢复（通常是 reactor 线程），恢复后不应长时间阻塞
+template <typename Stub, typename Request, typename Response>
+class CallAwaiter : public google::protobuf::Closure {
+public:
+    using Method = void (Stub::*)(google::protobuf::RpcController*, const Request*, Response*,
+                                  google::protobuf::Closure*);
+
+    CallAwaiter(Stub* stub, Method method, google::protobuf::RpcController* controller, const Request& request)
+        : stub_(stub), method_(method), controller_(controller), request_(&request), state_(kPending) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        (stub_->*method_)(controller_, request_, &response_, this);
+        // done 已在调用内同步执行（例如服务发现失败）时不挂起，直接继续
+        return state_.exchange(kSuspended, std::memory_order_acq_rel) != kCompleted;
+    }
+
+    Response await_resume() { return std::move(response_); }
+
+    void Run() override {
+        if (state_.exchange(kCompleted, std::memory_order_acq_rel) == kSuspended) {
+            handle_.resume();
+        }
+    }
+
+private:
+    enum State { kPending, kSuspended, kCompleted };
+
+    Stub* stub_;
+    Method method_;
+    google::protobuf::RpcController* controller_;
+    const Request* request_;
+    Response response_;
+    std::coroutine_handle<> handle_;
+    std::atomic<int> state_;
+};
+
+// 以协程方式调用 stub 方法：Response r = co_await CoCall(&stub, &UserService_Stub::Login, &controller, request);
+// 调用结果通过 controller 判断，与回调风格一致
+template <typename Stub, typename Service, typename Request, typename Response>
+CallAwaiter<Service, Request, Response> CoCall(
+    Stub* stub,
+    void (Service::*method)(google::protobuf::RpcController*, const Request*, Response*, google::protobuf::Closure*),
+    google::protobuf::RpcController* controller,
+    const Request& request) {
+    return CallAwaiter<Service, Request, Response>(stub, method, controller, request);
+}
+
+namespace detail {
+
+inline DetachedTask RunDetached(Task<void> task, google::protobuf::RpcController* controller,
+                                google::protobuf::Closure* done) {
+    try {
+        co_await task;
+    } catch (const std::exception& e) {
+        if (controller) controller->SetFailed(e.what());
+    } catch (...) {
+        if (controller) controller->SetFailed("Unknown exception in coroutine handler");
+    }
+    if (done) done->Run();
+}
+
+template <typename T>
+struct SyncState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+DetachedTask RunAndNotify(Task<T>& task, SyncState<T>& state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            state.value.emplace(co_await task);
+        }
+    } catch (...) {
+        state.exception = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done = true;
+    state.cv.notify_one();
+}
+
+} // namespace detail
+
+// 在服务方法中启动协程处理函数：协程结束后执行 done，协程抛出的异常记录到 controller
+// void Login(RpcController* c, const LoginRequest* req, LoginResponse* resp, Closure* done) override {
+//     xrpc::Spawn(DoLogin(c, req, resp), c, done);
+// }
+inline void Spawn(Task<void> task, google::protobuf::RpcController* controller, google::protobuf::Closure* done) {
+    detail::RunDetached(std::move(task), controller, done);
+}
+
+// 阻塞当前线程直到协程完成，用于在普通函数（如 main）中驱动协程；不要在 reactor 线程上调用
+template <typename T>
+T SyncWait(Task<T> task) {
+    detail::SyncState<T> state;
+    detail::RunAndNotify(task, state);
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.cv.wait(lock, [&state] { return state.done; });
+    if (state.exception) {
+        std::rethrow_exception(state.exception);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*state.value);
+    }
+}
+
+} // namespace xrpc
+
+#endif // XRPC_HAS_COROUTINES
+
+#endif // XRPC_CORO_H
@@ -0,0 +1,116 @@
+#include "core/server/worker_pool.h"
+#include "core/common/xrpc_logger.h"
+#include <algorithm>
+
+namespace xrpc {
+
+namespace {
+// 当前线程所属的线程池及下标，用于把任务提交到本线程队列
+thread_local WorkerPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+} // namespace
+
+WorkerPool::WorkerPool(size_t size) : pending_(0), next_(0), stopped_(false) {
+    if (size == 0) {
+        size = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < size; ++i) {
+        workers_.emplace_back(new Worker);
+    }
+    for (size_t i = 0; i < size; ++i) {
+        threads_.emplace_back([this, i]() { Run(i); });
+    }
+    XRPC_LOG_DEBUG("WorkerPool started with {} workers", size);
+}
+
+WorkerPool::~WorkerPool() {
+    Stop();
+}
+
+void WorkerPool::Submit(Task task) {
+    size_t index = current_pool == this ? current_index
+                                        : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    // 先计数再入队，取到任务的线程递减时计数不会下溢
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // 与 Run 中的等待条件同步，避免丢失唤醒
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+bool WorkerPool::PopLocal(size_t index, Task& task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    // 本线程取最新的任务，数据更可能还在缓存中
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool WorkerPool::Steal(size_t index, Task& task) {
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker& victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            // 窃取最早的任务，与队列主人取任务的一端错开
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::Run(size_t index) {
+    current_pool = this;
+    current_index = index;
+    Task task;
+    while (true) {
+        if (PopLocal(index, task) || Steal(index, task)) {
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            try {
+                task();
+            } catch (const std::exception& e) {
+                XRPC_LOG_ERROR("Worker task failed: {}", e.what());
+            }
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() {
+            return stopped_.load(std::memory_order_acquire) || pending_.load(std::memory_order_acquire) > 0;
+        });
+        if (stopped_.load(std::memory_order_acquire) && pending_.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+    }
+    current_pool = nullptr;
+}
+
+void WorkerPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopped_.store(true, std::memory_order_release);
+    }
+    sleep_cv_.notify_all();
+    for (auto& thread : threads_) {
+        if (!thread.joinable()) {
+            continue;
+        }
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach(); // 在工作线程内析构时无法 join 自身
+        } else {
+            thread.join();
+        }
+    }
+}
+
+} // namespace xrpc
@@ -0,0 +1,57 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xrpc {
+
+// 业务处理线程池：每个工作线程有自己的任务队列，空闲时从其他线程的队列头部窃取任务
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    // size 为 0 时使用 CPU 核数
+    explicit WorkerPool(size_t size);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // 工作线程内提交的任务放入本线程队列，其他线程提交的任务轮询分配
+    void Submit(Task task);
+
+    size_t Size() const { return workers_.size(); }
+
+    // 执行完已提交的任务后停止所有工作线程
+    void Stop();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks; // 本线程从尾部取，其他线程从头部窃取
+    };
+
+    void Run(size_t index);
+    bool PopLocal(size_t index, Task& task);
+    bool Steal(size_t index, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex sleep_mutex_; // 只用于空闲线程的休眠与唤醒
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> next_;
+    std::atomic<bool> stopped_;
+};
+
+} // namespace xrpc
+
+#endif // WORKER_POOL_H
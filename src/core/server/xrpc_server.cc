@@ -1,19 +1,119 @@
 #include "core/server/xrpc_server.h"
 #include "core/common/xrpc_logger.h"
 #include "core/controller/xrpc_controller.h"
+#include "registry/service_instance.h"
 #include "xrpc.pb.h"
+#include <google/protobuf/arena.h>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <vector>
 #include <stdexcept>
 
 namespace xrpc {
 
-XrpcServer::XrpcServer(const std::string& config_file) : zk_client_(new ZookeeperClient), transport_(new AsioTransport) {
+namespace {
+// Arena 首块的进程内空闲链表：调用在 I/O 线程上创建、通常在工作线程上销毁，线程局部缓存会一边只取一边只还
+// 上限之外的块直接释放，空闲时最多占用 kMaxCachedArenaBlocks * kArenaBlockSize 字节
+constexpr size_t kMaxCachedArenaBlocks = 256;
+std::mutex arena_block_mutex;
+std::vector<std::unique_ptr<char[]>> arena_block_cache;
+
+// 从空闲链表取出或新建一块 Arena 首块，析构时放回
+struct CachedArenaBlock {
+    CachedArenaBlock() {
+        {
+            std::lock_guard<std::mutex> lock(arena_block_mutex);
+            if (!arena_block_cache.empty()) {
+                data = std::move(arena_block_cache.back());
+                arena_block_cache.pop_back();
+                return;
+            }
+        }
+        data.reset(new char[XrpcServer::kArenaBlockSize]);
+    }
+    ~CachedArenaBlock() {
+        std::lock_guard<std::mutex> lock(arena_block_mutex);
+        if (arena_block_cache.size() < kMaxCachedArenaBlocks) {
+            arena_block_cache.push_back(std::move(data));
+        }
+    }
+    std::unique_ptr<char[]> data;
+};
+
+// 由请求头携带的剩余时间换算出本地截止时间，未携带时不限时
+std::chrono::steady_clock::time_point RequestDeadline(const RpcHeader& header,
+                                                      std::chrono::steady_clock::time_point now) {
+    auto it = header.metadata().find(kTimeoutMetadataKey);
+    if (it == header.metadata().end()) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    char* end = nullptr;
+    long long timeout_ms = std::strtoll(it->second.c_str(), &end, 10);
+    if (end == it->second.c_str() || *end != '\0' || timeout_ms <= 0) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return now + std::chrono::milliseconds(timeout_ms);
+}
+
+// 响应头只带回请求 ID 和服务、方法名，不回显请求头中的元数据
+RpcHeader MakeResponseHeader(const RpcHeader& request_header) {
+    RpcHeader header;
+    header.set_request_id(request_header.request_id());
+    header.set_service_name(request_header.service_name());
+    header.set_method_name(request_header.method_name());
+    return header;
+}
+
+google::protobuf::ArenaOptions MakeArenaOptions(char* block) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block;
+    options.initial_block_size = XrpcServer::kArenaBlockSize;
+    return options;
+}
+} // namespace
+
+// 一次服务端调用的上下文，存活到处理函数执行 done 并完成回复
+struct ServerCall {
+    ServerCall() : arena(MakeArenaOptions(block.data.get())) {}
+
+    CachedArenaBlock block; // 必须先于 arena 构造、晚于 arena 析构
+    google::protobuf::Arena arena;
+    std::shared_ptr<const DispatchTable> table; // 保证 entry 在调用期间有效
+    const MethodEntry* entry = nullptr;
+    RpcHeader* header = nullptr; // 以下三个消息都分配在 arena 上
+    google::protobuf::Message* request = nullptr;
+    google::protobuf::Message* response = nullptr;
+    XrpcController controller;
+    AsioTransport::Responder respond;
+    std::atomic<bool> finished{false}; // 保证只回复一次
+};
+
+XrpcServer::XrpcServer(const std::string& config_file)
+    : zk_client_(new ZookeeperClient), dispatch_table_(std::make_shared<DispatchTable>()) {
     config_.Load(config_file);
+    transport_.reset(new AsioTransport(std::stoul(config_.Get("io_threads", "1")),
+                                       IoContextPool::ParseBalance(config_.Get("io_balance", "round_robin"))));
+    size_t handler_threads = std::stoul(config_.Get("handler_threads", "0"));
+    if (handler_threads > 0) {
+        worker_pool_.reset(new WorkerPool(handler_threads));
+    }
+    // 逗号分隔的 "服务名.方法名"，这些方法直接在 I/O 线程上执行
+    std::stringstream inline_methods(config_.Get("inline_methods", ""));
+    std::string method;
+    while (std::getline(inline_methods, method, ',')) {
+        if (!method.empty()) {
+            inline_methods_.insert(method);
+        }
+    }
     Init();
 }
 
 XrpcServer::~XrpcServer() {
-    std::lock_guard<std::mutex> lock(mutex_);
     transport_->Stop();
+    if (worker_pool_) {
+        worker_pool_->Stop();
+    }
     zk_client_->Stop();
 }
 
@@ -21,22 +121,42 @@ void XrpcServer::Init() {
     zk_client_->Start();
     server_ip_ = config_.Get("server_ip", "0.0.0.0");
     server_port_ = std::stoi(config_.Get("server_port", "8080"));
-    transport_->StartServer(server_ip_, server_port_, [this](const std::string& data, std::string& response) {
-        OnMessage(data, response);
-    });
+    bool reuse_port = config_.Get("reuse_port", "false") == "true";
+    transport_->SetWriteHighWaterMark(std::stoul(config_.Get("write_high_water_mark",
+        std::to_string(AsioTransport::kDefaultWriteHighWaterMark))));
+    transport_->StartCancellableServer(server_ip_, server_port_, [this](FrameView request, AsioTransport::Responder respond) {
+        return OnRequest(std::move(request), std::move(respond));
+    }, reuse_port);
 }
 
 void XrpcServer::RegisterService(google::protobuf::Service* service) {
     std::lock_guard<std::mutex> lock(mutex_);
-    std::string service_name = service->GetDescriptor()->name();
-    services_[service_name] = service;
+    const google::protobuf::ServiceDescriptor* descriptor = service->GetDescriptor();
+    std::string service_name = descriptor->name();
+    // 复制当前快照并加入新服务，整体发布后正在处理的请求仍使用旧快照
+    auto table = std::make_shared<DispatchTable>(*LoadDispatchTable());
+    table->services[service_name] = service;
+    // 注册时为每个方法预先建好分发表项，处理请求时只需一次哈希查找
+    for (int i = 0; i < descriptor->method_count(); ++i) {
+        const google::protobuf::MethodDescriptor* method = descriptor->method(i);
+        std::string key = service_name + "." + method->name();
+        MethodEntry& entry = table->methods[key];
+        entry.service = service;
+        entry.method_descriptor = method;
+        entry.request_prototype = &service->GetRequestPrototype(method);
+        entry.response_prototype = &service->GetResponsePrototype(method);
+        entry.stats = std::make_shared<MethodStats>();
+        entry.run_inline = inline_methods_.count(key) > 0;
+    }
+    std::atomic_store(&dispatch_table_, std::shared_ptr<const DispatchTable>(std::move(table)));
 
     std::string path = "/" + service_name + "/" + server_ip_ + ":" + std::to_string(server_port_);
-    std::string data = "methods=";
-    for (int i = 0; i < service->GetDescriptor()->method_count(); ++i) {
-        if (i > 0) data += ",";
-        data += service->GetDescriptor()->method(i)->name();
+    std::vector<std::string> methods;
+    for (int i = 0; i < descriptor->method_count(); ++i) {
+        methods.push_back(descriptor->method(i)->name());
     }
+    // 权重供客户端的 weighted_random 与 ring_hash 策略使用
+    std::string data = FormatInstanceData(methods, std::stoul(config_.Get("server_weight", "1")));
     zk_client_->Register(path, data, true);
     XRPC_LOG_INFO("Registered service {} at {}", service_name, path);
 }
@@ -46,121 +166,211 @@ void XrpcServer::Start() {
     transport_->Run();
 }
 
-void XrpcServer::OnMessage(const std::string& data, std::string& response) {
+AsioTransport::CancelHook XrpcServer::OnRequest(FrameView request, AsioTransport::Responder respond) {
+    // I/O 线程上只解析头部并定位方法，业务处理按方法配置内联执行或交给工作线程池
+    std::shared_ptr<ServerCall> call;
     try {
-        RpcHeader header;
-        std::string args;
-        if (!codec_.Decode(data, header, args)) {
+        // 头部直接在接收缓冲区上解析到调用上下文的 Arena 上，body 指向接收缓冲区中的数据
+        call = std::make_shared<ServerCall>();
+        call->header = google::protobuf::Arena::CreateMessage<RpcHeader>(&call->arena);
+        RpcHeader& header = *call->header;
+        const char* body = nullptr;
+        size_t body_size = 0;
+        if (!codec_.DecodeHeader(request.data, request.size, header, &body, &body_size)) {
             XRPC_LOG_ERROR("Failed to decode request");
-            RpcHeader error_header = header;
-            error_header.set_status(1);
-            error_header.mutable_error()->set_code(1);
-            error_header.mutable_error()->set_message("Failed to decode request");
-            response = codec_.EncodeResponse(error_header, RpcHeader());
-            return;
+            respond(EncodeError(header, 1, "Failed to decode request"));
+            return nullptr;
         }
 
         // 检查取消标志
         if (header.cancelled()) {
             XRPC_LOG_INFO("Request for {}.{} canceled", header.service_name(), header.method_name());
-            RpcHeader error_header = header;
-            error_header.set_status(1);
-            error_header.mutable_error()->set_code(static_cast<int>(ErrorCode::CANCELLED));
-            error_header.mutable_error()->set_message("Request canceled by client");
-            response = codec_.EncodeResponse(error_header, RpcHeader());
-            return;
+            respond(EncodeError(header, static_cast<int>(ErrorCode::CANCELLED), "Request canceled by client"));
+            return nullptr;
         }
 
-        auto it = services_.find(header.service_name());
-        if (it == services_.end()) {
-            XRPC_LOG_ERROR("Service {} not found", header.service_name());
-            RpcHeader error_header = header;
-            error_header.set_status(1);
-            error_header.mutable_error()->set_code(2);
-            error_header.mutable_error()->set_message("Service not found");
-            response = codec_.EncodeResponse(error_header, RpcHeader());
-            return;
+        // 持有快照直到处理结束，entry 在此期间一直有效
+        std::shared_ptr<const DispatchTable> table = LoadDispatchTable();
+        const MethodEntry* entry = table->Find(header.service_name(), header.method_name());
+        if (!entry) {
+            if (table->services.count(header.service_name()) == 0) {
+                XRPC_LOG_ERROR("Service {} not found", header.service_name());
+                respond(EncodeError(header, 2, "Service not found"));
+            } else {
+                XRPC_LOG_ERROR("Method {}.{} not found", header.service_name(), header.method_name());
+                respond(EncodeError(header, 3, "Method not found"));
+            }
+            return nullptr;
         }
 
-        google::protobuf::Service* service = it->second;
-        const google::protobuf::MethodDescriptor* method_desc = nullptr;
-        for (int i = 0; i < service->GetDescriptor()->method_count(); ++i) {
-            if (service->GetDescriptor()->method(i)->name() == header.method_name()) {
-                method_desc = service->GetDescriptor()->method(i);
-                break;
+        call->table = std::move(table);
+        call->entry = entry;
+        call->respond = std::move(respond);
+        // 截止时间从收到请求时开始计算，排队等待的时间也计入；处理函数可据此向下游传递截止时间
+        call->controller.SetDeadline(RequestDeadline(header, std::chrono::steady_clock::now()));
+
+        // 客户端发来 CANCEL 帧或断开时取消服务端控制器，触发处理函数登记的 NotifyOnCancel
+        std::weak_ptr<ServerCall> weak_call = call;
+        AsioTransport::CancelHook cancel = [weak_call]() {
+            if (std::shared_ptr<ServerCall> call = weak_call.lock()) {
+                call->controller.StartCancel();
             }
+        };
+        if (entry->run_inline) {
+            InvokeMethod(call, body, body_size);
+            return cancel;
         }
-
-        if (!method_desc) {
-            XRPC_LOG_ERROR("Method {}.{} not found", header.service_name(), header.method_name());
-            RpcHeader error_header = header;
-            error_header.set_status(1);
-            error_header.mutable_error()->set_code(3);
-            error_header.mutable_error()->set_message("Method not found");
-            response = codec_.EncodeResponse(error_header, RpcHeader());
-            return;
+        // request 持有接收缓冲块，body 在任务执行期间保持有效
+        auto task = [this, call, request = std::move(request), body, body_size]() {
+            InvokeMethod(call, body, body_size);
+        };
+        if (worker_pool_) {
+            worker_pool_->Submit(std::move(task));
+        } else {
+            // 没有工作线程池时派发到 reactor 池，慢处理函数不阻塞同一连接上的后续请求
+            transport_->Post(std::move(task));
+        }
+        return cancel;
+    } catch (const std::exception& e) {
+        XRPC_LOG_ERROR("OnRequest failed: {}", e.what());
+        if (!call || !call->respond) { // 尚未分派，respond 仍归本函数所有
+            respond(EncodeError(RpcHeader(), 6, "Internal server error"));
+        } else if (!call->finished.exchange(true)) {
+            call->respond(EncodeError(*call->header, 6, "Internal server error"));
         }
+        return nullptr;
+    }
+}
 
-        std::unique_ptr<google::protobuf::Message> request(service->GetRequestPrototype(method_desc).New());
-        std::unique_ptr<google::protobuf::Message> response_msg(service->GetResponsePrototype(method_desc).New());
+void XrpcServer::InvokeMethod(std::shared_ptr<ServerCall> call, const char* body, size_t body_size) {
+    const MethodEntry& entry = *call->entry;
+    const RpcHeader& request_header = *call->header;
+    // 出队时调用方已放弃的请求不再执行处理函数，也不回复
+    if (call->controller.IsCanceled()) {
+        entry.stats->cancelled.fetch_add(1, std::memory_order_relaxed);
+        XRPC_LOG_INFO("Drop canceled request for {}.{}", request_header.service_name(), request_header.method_name());
+        call->finished = true;
+        call->respond(std::string());
+        return;
+    }
+    if (std::chrono::steady_clock::now() >= call->controller.Deadline()) {
+        entry.stats->expired.fetch_add(1, std::memory_order_relaxed);
+        XRPC_LOG_WARN("Drop expired request for {}.{}", request_header.service_name(), request_header.method_name());
+        call->finished = true;
+        call->respond(std::string());
+        return;
+    }
+    try {
+        // 请求和响应都分配在调用上下文的 Arena 上，回复后随上下文一次性释放
+        call->request = entry.request_prototype->New(&call->arena);
+        call->response = entry.response_prototype->New(&call->arena);
+        entry.stats->calls.fetch_add(1, std::memory_order_relaxed);
 
-        if (!request->ParseFromString(args)) {
-            XRPC_LOG_ERROR("Failed to parse request for {}.{}", header.service_name(), header.method_name());
-            RpcHeader error_header = header;
-            error_header.set_status(1);
-            error_header.mutable_error()->set_code(4);
-            error_header.mutable_error()->set_message("Failed to parse request");
-            response = codec_.EncodeResponse(error_header, RpcHeader());
+        if (!codec_.ParseBody(request_header, body, body_size, *call->request)) {
+            XRPC_LOG_ERROR("Failed to parse request for {}.{}", request_header.service_name(), request_header.method_name());
+            entry.stats->failures.fetch_add(1, std::memory_order_relaxed);
+            call->finished = true;
+            call->respond(EncodeError(request_header, 4, "Failed to parse request"));
             return;
         }
 
-        ServiceDescriptor desc{header.service_name(), header.method_name(), method_desc};
+        // 处理函数可以立即返回，稍后在任意线程执行 done，响应在 done 执行时才编码发送
+        google::protobuf::Closure* done = google::protobuf::NewCallback(this, &XrpcServer::FinishCall, call);
         try {
-            CallServiceMethod(desc, request.get(), response_msg.get(), header.cancelled());
-            RpcHeader response_header = header;
-            response_header.set_status(0);
-            response = codec_.EncodeResponse(response_header, *response_msg);
-            XRPC_LOG_INFO("Processed request for {}.{}", header.service_name(), header.method_name());
+            entry.service->CallMethod(entry.method_descriptor, &call->controller, call->request, call->response, done);
         } catch (const std::exception& e) {
-            RpcHeader error_header = header;
-            error_header.set_status(1);
-            error_header.mutable_error()->set_code(5);
-            error_header.mutable_error()->set_message(e.what());
-            response = codec_.EncodeResponse(error_header, *response_msg);
-            XRPC_LOG_ERROR("Service call failed: {}.{}", header.service_name(), header.method_name());
+            // 处理函数抛出异常即放弃 done，之后不得再执行；尚未执行过 done 时由这里释放 done 并回复错误
+            if (!call->finished.exchange(true)) {
+                delete done;
+                entry.stats->failures.fetch_add(1, std::memory_order_relaxed);
+                XRPC_LOG_ERROR("Service call failed: {}.{}: {}", request_header.service_name(), request_header.method_name(), e.what());
+                call->respond(EncodeError(request_header, 5, e.what()));
+            }
         }
     } catch (const std::exception& e) {
-        XRPC_LOG_ERROR("OnMessage failed: {}", e.what());
-        RpcHeader error_header;
-        error_header.set_status(1);
-        error_header.mutable_error()->set_code(6);
-        error_header.mutable_error()->set_message("Internal server error");
-        response = codec_.EncodeResponse(error_header, RpcHeader());
+        XRPC_LOG_ERROR("InvokeMethod failed: {}", e.what());
+        if (!call->finished.exchange(true)) {
+            call->respond(EncodeError(request_header, 6, "Internal server error"));
+        }
     }
 }
 
-void XrpcServer::CallServiceMethod(const ServiceDescriptor& desc,
-                                  google::protobuf::Message* request,
-                                  google::protobuf::Message* response,
-                                  bool cancelled) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = services_.find(desc.service_name);
-    if (it == services_.end()) {
-        throw std::runtime_error("Service not found");
+void XrpcServer::FinishCall(std::shared_ptr<ServerCall> call) {
+    if (call->finished.exchange(true)) {
+        return;
     }
-
-    if (cancelled) {
-        throw std::runtime_error("Request canceled by client");
+    if (call->controller.IsCanceled()) {
+        // 客户端已取消，响应不会被读取，不再编码
+        call->entry->stats->cancelled.fetch_add(1, std::memory_order_relaxed);
+        call->respond(std::string());
+        return;
+    }
+    RpcHeader header = MakeResponseHeader(*call->header);
+    std::string response;
+    try {
+        if (call->controller.Failed()) {
+            XRPC_LOG_ERROR("Service call failed: {}", call->controller.ErrorText());
+            header.set_status(1);
+            header.mutable_error()->set_code(5);
+            header.mutable_error()->set_message(call->controller.ErrorText());
+            response = codec_.EncodeResponse(header, *call->response, FrameBuffer::kHeaderSize);
+            call->entry->stats->failures.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            header.set_status(0);
+            response = codec_.EncodeResponse(header, *call->response, FrameBuffer::kHeaderSize);
+            XRPC_LOG_INFO("Processed request for {}.{}", header.service_name(), header.method_name());
+        }
+    } catch (const std::exception& e) {
+        XRPC_LOG_ERROR("FinishCall failed: {}", e.what());
+        response = EncodeError(header, 6, "Internal server error");
     }
+    call->respond(std::move(response));
+}
 
-    google::protobuf::Service* service = it->second;
-    XrpcController controller;
-    service->CallMethod(desc.method_descriptor, &controller, request, response, nullptr);
+std::string XrpcServer::EncodeError(const RpcHeader& header, int code, const std::string& message) {
+    RpcHeader error_header = MakeResponseHeader(header);
+    error_header.set_status(1);
+    error_header.mutable_error()->set_code(code);
+    error_header.mutable_error()->set_message(message);
+    return codec_.EncodeResponse(error_header, RpcHeader(), FrameBuffer::kHeaderSize);
+}
 
-    if (controller.Failed()) {
-        XRPC_LOG_ERROR("Service call failed: {}", controller.ErrorText());
-        throw std::runtime_error(controller.ErrorText());
+void XrpcServer::SetMethodInline(const std::string& service_name, const std::string& method_name, bool run_inline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = service_name + "." + method_name;
+    if (run_inline) {
+        inline_methods_.insert(key);
+    } else {
+        inline_methods_.erase(key);
+    }
+    auto table = std::make_shared<DispatchTable>(*LoadDispatchTable());
+    auto it = table->methods.find(key);
+    if (it == table->methods.end()) {
+        return; // 尚未注册，注册时按 inline_methods_ 设置
     }
+    it->second.run_inline = run_inline;
+    std::atomic_store(&dispatch_table_, std::shared_ptr<const DispatchTable>(std::move(table)));
+}
+
+const MethodEntry* DispatchTable::Find(const std::string& service_name, const std::string& method_name) const {
+    // 复用线程局部的 key 缓冲区，查表过程不分配内存
+    thread_local std::string key;
+    key.assign(service_name);
+    key.push_back('.');
+    key.append(method_name);
+
+    auto it = methods.find(key);
+    return it == methods.end() ? nullptr : &it->second;
+}
+
+std::shared_ptr<const DispatchTable> XrpcServer::LoadDispatchTable() const {
+    return std::atomic_load(&dispatch_table_);
+}
+
+const MethodStats* XrpcServer::GetMethodStats(const std::string& service_name, const std::string& method_name) {
+    // 统计对象由所有快照共享，生命周期与 server 相同
+    const MethodEntry* entry = LoadDispatchTable()->Find(service_name, method_name);
+    return entry ? entry->stats.get() : nullptr;
 }
 
 } // namespace xrpc
\ No newline at end of file
@@ -5,15 +5,49 @@
 #include "core/common/xrpc_config.h"
 #include "core/codec/xrpc_codec.h"
 #include "registry/zookeeper_client.h"
+#include "core/server/worker_pool.h"
 #include "transport/asio_transport.h"
 #include <google/protobuf/service.h>
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <string>
 #include <mutex>
+#include <set>
+#include <unordered_map>
 
 namespace xrpc {
 
+// 单个方法的调用统计
+struct MethodStats {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> expired{0}; // 出队时调用方已超时、未执行处理函数就丢弃的请求
+    std::atomic<uint64_t> cancelled{0}; // 被客户端取消、未回复的请求
+};
+
+// 方法分发表项：注册时缓存方法描述符和请求/响应原型
+struct MethodEntry {
+    google::protobuf::Service* service = nullptr;
+    const google::protobuf::MethodDescriptor* method_descriptor = nullptr;
+    const google::protobuf::Message* request_prototype = nullptr;
+    const google::protobuf::Message* response_prototype = nullptr;
+    std::shared_ptr<MethodStats> stats; // 在各个分发表快照之间共享
+    bool run_inline = false; // true 时直接在 I/O 线程上执行，否则交给工作线程池
+};
+
+struct ServerCall;
+
+// 分发表快照：发布后不再修改，注册新服务时复制一份再整体替换
+struct DispatchTable {
+    std::map<std::string, google::protobuf::Service*> services;
+    std::unordered_map<std::string, MethodEntry> methods; // key 为 "服务名.方法名"
+
+    // 未找到返回 nullptr，返回的指针在快照存活期间有效
+    const MethodEntry* Find(const std::string& service_name, const std::string& method_name) const;
+};
+
 class XrpcServer {
 public:
     XrpcServer(const std::string& config_file);
@@ -25,27 +59,45 @@ public:
     // 启动服务器
     void Start();
 
+    // 设置方法是否直接在 I/O 线程上执行（适合耗时很短的方法），默认交给工作线程池
+    void SetMethodInline(const std::string& service_name, const std::string& method_name, bool run_inline);
+
+    // 每次调用 Arena 首块的大小，首块取自进程内共享的有界空闲链表
+    static constexpr size_t kArenaBlockSize = 16 * 1024;
+
+    // 查询方法的调用统计，方法未注册时返回 nullptr
+    const MethodStats* GetMethodStats(const std::string& service_name, const std::string& method_name);
+
 private:
     // 初始化 ZooKeeper 和 Asio
     void Init();
 
-    // 处理接收到的请求
-    void OnMessage(const std::string& data, std::string& response);
+    // 在 I/O 线程上解析请求头并分派，处理完成后通过 respond 回复；返回该请求的取消回调
+    AsioTransport::CancelHook OnRequest(FrameView request, AsioTransport::Responder respond);
+
+    // 解析请求体并调用服务方法，处理函数执行 done 后才编码并回复
+    // 开始执行时已被取消或已过截止时间则直接丢弃，不运行处理函数也不回复
+    void InvokeMethod(std::shared_ptr<ServerCall> call, const char* body, size_t body_size);
+
+    // 处理函数的 done：编码响应并回复，可在任意线程执行
+    void FinishCall(std::shared_ptr<ServerCall> call);
+
+    // 以下编码的响应都预留 FrameBuffer::kHeaderSize 字节帧头空间，可直接交给 Responder
+    std::string EncodeError(const RpcHeader& header, int code, const std::string& message);
 
-    // 调用服务方法
-    void CallServiceMethod(const ServiceDescriptor& desc,
-                          google::protobuf::Message* request,
-                          google::protobuf::Message* response,
-                          bool cancelled);
+    // 取当前分发表快照，不争用注册使用的 mutex_
+    std::shared_ptr<const DispatchTable> LoadDispatchTable() const;
 
     XrpcConfig config_;
     XrpcCodec codec_;
     std::unique_ptr<ZookeeperClient> zk_client_;
     std::unique_ptr<AsioTransport> transport_;
-    std::map<std::string, google::protobuf::Service*> services_;
+    std::unique_ptr<WorkerPool> worker_pool_; // handler_threads 为 0 时为空，非内联方法派发到 reactor 池执行
+    std::set<std::string> inline_methods_; // "服务名.方法名"
+    std::shared_ptr<const DispatchTable> dispatch_table_; // 通过 std::atomic_load/atomic_store 访问
     std::string server_ip_;
     int server_port_;
-    std::mutex mutex_;
+    std::mutex mutex_; // 只串行化注册，不参与请求处理
 };
 
 } // namespace xrpc
@@ -0,0 +1,47 @@
+#include "registry/service_instance.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace xrpc {
+
+std::string FormatInstanceData(const std::vector<std::string>& methods, uint32_t weight) {
+    std::string data = "methods=";
+    for (size_t i = 0; i < methods.size(); ++i) {
+        if (i > 0) data += ",";
+        data += methods[i];
+    }
+    data += "\nweight=" + std::to_string(weight > 0 ? weight : 1);
+    return data;
+}
+
+bool ParseInstanceData(const std::string& data, InstanceInfo* info) {
+    info->methods.clear();
+    info->weight = 1;
+    bool has_methods = false;
+    std::stringstream lines(data);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+        if (key == "methods") {
+            has_methods = true;
+            std::stringstream methods(value);
+            std::string method;
+            while (std::getline(methods, method, ',')) {
+                if (!method.empty()) {
+                    info->methods.push_back(method);
+                }
+            }
+        } else if (key == "weight") {
+            long weight = std::strtol(value.c_str(), nullptr, 10);
+            info->weight = weight > 0 ? static_cast<uint32_t>(weight) : 1;
+        }
+    }
+    return has_methods;
+}
+
+} // namespace xrpc
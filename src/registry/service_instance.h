@@ -0,0 +1,34 @@
+#ifndef XRPC_REGISTRY_SERVICE_INSTANCE_H
+#define XRPC_REGISTRY_SERVICE_INSTANCE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xrpc {
+/***
+注册节点 /服务名/ip:port 的数据，每行一个 key=value：
+methods=Login,Register
+weight=2
+未知的键被忽略，缺省 weight 为 1
+***/
+
+struct InstanceInfo {
+    std::string address; // "ip:port"，取自节点名
+    std::vector<std::string> methods;
+    uint32_t weight = 1;
+};
+
+// 按地址排序的实例列表，构造后只读，在注册中心缓存与调用方之间共享
+using InstanceList = std::vector<std::shared_ptr<const InstanceInfo>>;
+
+// 生成节点数据
+std::string FormatInstanceData(const std::vector<std::string>& methods, uint32_t weight = 1);
+
+// 解析节点数据，address 由调用方填写；methods 行缺失时返回 false
+bool ParseInstanceData(const std::string& data, InstanceInfo* info);
+
+} // namespace xrpc
+
+#endif // XRPC_REGISTRY_SERVICE_INSTANCE_H
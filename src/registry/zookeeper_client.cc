@@ -1,12 +1,15 @@
 #include "registry/zookeeper_client.h"
+#include <algorithm>
 #include <stdexcept>
 #include <thread>
+#include <unordered_set>
 #include <chrono>
 #include <zookeeper/zookeeper.h>
 
 namespace xrpc {
 
-ZookeeperClient::ZookeeperClient() : zk_handle_(nullptr), is_connected_(false), running_(false) {
+ZookeeperClient::ZookeeperClient()
+    : zk_handle_(nullptr), is_connected_(false), running_(false), cache_(std::make_shared<CacheSnapshot>()) {
     config_.Load("/home/tan/program/CppWorkSpace/xrpc/configs/xrpc.conf");
 }
 
@@ -49,14 +52,18 @@ void ZookeeperClient::Start() {
 }
 
 void ZookeeperClient::Stop() {
-    running_ = false;
+    {
+        std::lock_guard lock(stop_mutex_);
+        running_ = false;
+    }
+    stop_cv_.notify_all();
     if (heartbeat_thread_.joinable()) {
         heartbeat_thread_.join();
     }
     {
         std::lock_guard lock(cache_mutex_);
         watchers_.clear();
-        service_cache_.clear();
+        StoreCache(std::make_shared<CacheSnapshot>());
     }
     if (zk_handle_) {
         zookeeper_close(zk_handle_);
@@ -66,7 +73,7 @@ void ZookeeperClient::Stop() {
 }
 
 void ZookeeperClient::Register(const std::string& path, const std::string& data, bool ephemeral) {
-    std::lock_guard lock(mutex_);
+    std::unique_lock lock(mutex_);
     if (!is_connected_ || !zk_handle_) {
         XRPC_LOG_ERROR("ZooKeeper not connected");
         throw std::runtime_error("ZooKeeper not connected");
@@ -103,107 +110,241 @@ void ZookeeperClient::Register(const std::string& path, const std::string& data,
         }
     }
 
+    // 已缓存的服务立即更新，watch 事件随后到达时数据相同不再重复通知
+    std::string service = path.substr(1, path.find('/', 1) - 1);
+    bool changed = false;
     {
         std::lock_guard lock(cache_mutex_);
-        std::string service = path.substr(1, path.find('/', 1) - 1);
-        auto& instances = service_cache_[service];
-        auto it = std::find_if(instances.begin(), instances.end(),
-                               [&path](const auto& p) { return p.first == path; });
-        if (it != instances.end()) {
-            it->second = data;
-        } else {
-            instances.emplace_back(path, data);
-        }
+        changed = UpdateService(service, [&](ServiceEntry& entry) { return UpsertNode(entry, path, data); });
     }
 
     XRPC_LOG_INFO("Registered node {} with data: {}", path, data);
+    lock.unlock();
+    if (changed) {
+        NotifyServiceChanged(service);
+    }
 }
 
 std::string ZookeeperClient::Discover(const std::string& path) {
-    std::lock_guard lock(mutex_);
-    {
-        std::lock_guard lock(cache_mutex_);
-        std::string service = path.substr(1, path.find('/', 1) - 1);
-        auto it = service_cache_.find(service);
-        if (it != service_cache_.end()) {
-            for (const auto& instance : it->second) {
-                if (instance.first == path) {
-                    XRPC_LOG_DEBUG("Cache hit for node {}: {}", path, instance.second);
-                    return instance.second;
-                }
+    std::shared_ptr<const CacheSnapshot> cache = LoadCache();
+    auto it = cache->find(path.substr(1, path.find('/', 1) - 1));
+    if (it != cache->end()) {
+        for (const auto& instance : it->second->nodes) {
+            if (instance.first == path) {
+                XRPC_LOG_DEBUG("Cache hit for node {}: {}", path, instance.second);
+                return instance.second;
             }
         }
     }
 
-    std::string data = GetNodeData(path);
-    {
-        std::lock_guard lock(cache_mutex_);
-        std::string service = path.substr(1, path.find('/', 1) - 1);
-        auto& instances = service_cache_[service];
-        auto it = std::find_if(instances.begin(), instances.end(),
-                               [&path](const auto& p) { return p.first == path; });
-        if (it != instances.end()) {
-            it->second = data;
-        } else {
-            instances.emplace_back(path, data);
-        }
+    std::lock_guard lock(mutex_);
+    return GetNodeData(path);
+}
+
+std::shared_ptr<const ZookeeperClient::NodeList> ZookeeperClient::DiscoverService(const std::string& service) {
+    static const std::shared_ptr<const NodeList> kNoNodes = std::make_shared<const NodeList>();
+    std::shared_ptr<const ServiceEntry> entry = FindService(service);
+    if (!entry) {
+        return kNoNodes;
+    }
+    // 与条目共享所有权，不复制节点列表
+    return std::shared_ptr<const NodeList>(entry, &entry->nodes);
+}
+
+std::shared_ptr<const InstanceList> ZookeeperClient::FindInstancesByMethod(const std::string& service,
+                                                                          const std::string& method) {
+    static const std::shared_ptr<const InstanceList> kNoInstances = std::make_shared<const InstanceList>();
+    std::shared_ptr<const ServiceEntry> entry = FindService(service);
+    if (!entry) {
+        return kNoInstances;
     }
-    return data;
+    auto found = entry->by_method.find(method);
+    return found != entry->by_method.end() ? found->second : kNoInstances;
 }
 
-std::vector<std::pair<std::string, std::string>> ZookeeperClient::DiscoverService(const std::string& service) {
+std::shared_ptr<const ZookeeperClient::ServiceEntry> ZookeeperClient::FindService(const std::string& service) {
+    // 已缓存时只读取一次快照指针，不与事件线程和定期核对争用 mutex_/cache_mutex_
+    std::shared_ptr<const CacheSnapshot> cache = LoadCache();
+    auto it = cache->find(service);
+    if (it != cache->end()) {
+        return it->second;
+    }
+
     std::lock_guard lock(mutex_);
-    {
-        std::lock_guard lock(cache_mutex_);
-        auto it = service_cache_.find(service);
-        if (it != service_cache_.end()) {
-            XRPC_LOG_DEBUG("Cache hit for service {}", service);
-            return it->second;
-        }
+    LoadService(service);
+    cache = LoadCache();
+    it = cache->find(service);
+    return it != cache->end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const ZookeeperClient::CacheSnapshot> ZookeeperClient::LoadCache() const {
+    return std::atomic_load(&cache_);
+}
+
+void ZookeeperClient::StoreCache(std::shared_ptr<const CacheSnapshot> snapshot) {
+    std::atomic_store(&cache_, std::move(snapshot));
+}
+
+bool ZookeeperClient::UpdateService(const std::string& service,
+                                    const std::function<bool(ServiceEntry&)>& update) {
+    std::shared_ptr<const CacheSnapshot> cache = LoadCache();
+    auto it = cache->find(service);
+    if (it == cache->end()) {
+        return false;
+    }
+    auto entry = std::make_shared<ServiceEntry>(*it->second);
+    if (!update(*entry)) {
+        return false;
     }
+    auto next = std::make_shared<CacheSnapshot>(*cache);
+    if (entry->nodes.empty()) {
+        next->erase(service);
+    } else {
+        (*next)[service] = std::move(entry);
+    }
+    StoreCache(std::move(next));
+    return true;
+}
 
+void ZookeeperClient::LoadService(const std::string& service) {
+    if (LoadCache()->count(service)) {
+        XRPC_LOG_DEBUG("Cache hit for service {}", service);
+        return;
+    }
+
+    // 持有 sync_mutex_ 直到写入缓存，拉取期间到达的子节点事件在之后处理，不会因服务尚未缓存而被忽略
+    std::lock_guard sync_lock(sync_mutex_);
     String_vector children;
     std::string service_path = "/" + service;
-    int ret = zoo_get_children(zk_handle_, service_path.c_str(), 0, &children);
+    // 设置子节点监听，之后实例的增减由 ZOO_CHILD_EVENT 推送
+    int ret = zoo_wget_children(zk_handle_, service_path.c_str(), WatcherCallback, this, &children);
     if (ret != ZOK) {
         XRPC_LOG_ERROR("Failed to get children for {}: {}", service, zerror(ret));
         throw std::runtime_error("Failed to get children: " + std::string(zerror(ret)));
     }
 
-    std::vector<std::pair<std::string, std::string>> instances;
+    NodeList nodes;
     for (int i = 0; i < children.count; ++i) {
         std::string path = service_path + "/" + children.data[i];
         try {
-            std::string data = GetNodeData(path);
-            instances.emplace_back(path, data);
+            std::string data = GetNodeData(path, true);
+            nodes.emplace_back(path, data);
         } catch (const std::exception& e) {
             XRPC_LOG_WARN("Failed to get data for {}: {}", path, e.what());
         }
     }
     deallocate_String_vector(&children);
 
-    {
-        std::lock_guard lock(cache_mutex_);
-        service_cache_[service] = instances;
+    auto entry = std::make_shared<const ServiceEntry>(BuildEntry(std::move(nodes)));
+    std::lock_guard lock(cache_mutex_);
+    auto next = std::make_shared<CacheSnapshot>(*LoadCache());
+    (*next)[service] = std::move(entry);
+    StoreCache(std::move(next));
+}
+
+ZookeeperClient::ServiceEntry ZookeeperClient::BuildEntry(NodeList nodes) {
+    ServiceEntry entry;
+    std::unordered_map<std::string, InstanceList> by_method;
+    for (const auto& [path, data] : nodes) {
+        auto info = std::make_shared<InstanceInfo>();
+        if (!ParseInstanceData(data, info.get())) {
+            XRPC_LOG_WARN("Node {} has no methods: {}", path, data);
+        }
+        info->address = path.substr(path.rfind('/') + 1);
+        for (const auto& method : info->methods) {
+            by_method[method].push_back(info);
+        }
+        entry.instances[path] = std::move(info);
+    }
+    for (auto& [method, list] : by_method) {
+        std::sort(list.begin(), list.end(), [](const auto& a, const auto& b) { return a->address < b->address; });
+        // 同一节点重复列出的方法只保留一次
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        entry.by_method.emplace(method, std::make_shared<const InstanceList>(std::move(list)));
+    }
+    entry.nodes = std::move(nodes);
+    return entry;
+}
+
+bool ZookeeperClient::UpsertNode(ServiceEntry& entry, const std::string& path, const std::string& data) {
+    auto node = std::find_if(entry.nodes.begin(), entry.nodes.end(),
+                             [&path](const auto& p) { return p.first == path; });
+    if (node != entry.nodes.end()) {
+        if (node->second == data) {
+            return false;
+        }
+        node->second = data;
+    } else {
+        entry.nodes.emplace_back(path, data);
+    }
+
+    auto info = std::make_shared<InstanceInfo>();
+    if (!ParseInstanceData(data, info.get())) {
+        XRPC_LOG_WARN("Node {} has no methods: {}", path, data);
+    }
+    info->address = path.substr(path.rfind('/') + 1);
+    std::shared_ptr<const InstanceInfo> old = entry.instances[path];
+    entry.instances[path] = info;
+
+    // 只改动新旧方法涉及的列表
+    if (old) {
+        std::unordered_set<std::string> current(info->methods.begin(), info->methods.end());
+        for (const auto& method : old->methods) {
+            if (!current.count(method)) {
+                IndexInstance(entry, method, info->address, nullptr);
+            }
+        }
+    }
+    for (const auto& method : info->methods) {
+        IndexInstance(entry, method, info->address, info);
+    }
+    return true;
+}
+
+bool ZookeeperClient::RemoveNode(ServiceEntry& entry, const std::string& path) {
+    entry.nodes.erase(std::remove_if(entry.nodes.begin(), entry.nodes.end(),
+                                     [&path](const auto& p) { return p.first == path; }),
+                      entry.nodes.end());
+    auto it = entry.instances.find(path);
+    if (it == entry.instances.end()) {
+        return false;
+    }
+    for (const auto& method : it->second->methods) {
+        IndexInstance(entry, method, it->second->address, nullptr);
     }
-    return instances;
+    entry.instances.erase(it);
+    return true;
 }
 
-std::vector<std::string> ZookeeperClient::FindInstancesByMethod(const std::string& service, const std::string& method) {
-    auto instances = DiscoverService(service);
-    std::vector<std::string> matching_instances;
-    for (const auto& [path, data] : instances) {
-        if (data.find("methods=" + method) != std::string::npos ||
-            data.find("methods=" + method + ",") != std::string::npos ||
-            data.find("," + method) != std::string::npos) {
-            matching_instances.push_back(path.substr(path.rfind('/') + 1));
+void ZookeeperClient::IndexInstance(ServiceEntry& entry, const std::string& method, const std::string& address,
+                                    const std::shared_ptr<const InstanceInfo>& instance) {
+    auto it = entry.by_method.find(method);
+    auto list = it != entry.by_method.end() ? std::make_shared<InstanceList>(*it->second)
+                                            : std::make_shared<InstanceList>();
+    auto pos = std::lower_bound(list->begin(), list->end(), address,
+                                [](const auto& info, const std::string& key) { return info->address < key; });
+    bool found = pos != list->end() && (*pos)->address == address;
+    if (instance) {
+        if (found) {
+            *pos = instance;
+        } else {
+            list->insert(pos, instance);
         }
+    } else if (found) {
+        list->erase(pos);
+    } else {
+        return;
+    }
+
+    if (list->empty()) {
+        entry.by_method.erase(method);
+    } else {
+        entry.by_method[method] = std::move(list);
     }
-    return matching_instances;
 }
 
 void ZookeeperClient::Delete(const std::string& path) {
-    std::lock_guard lock(mutex_);
+    std::unique_lock lock(mutex_);
     if (!zk_handle_) {
         throw std::runtime_error("ZookeeperClient::Delete - ZooKeeper client not started");
     }
@@ -222,21 +363,17 @@ void ZookeeperClient::Delete(const std::string& path) {
         throw std::runtime_error("ZookeeperClient::Delete - Failed to delete node: " + std::string(zerror(rc)));
     }
 
+    std::string service = path.substr(1, path.find('/', 1) - 1);
+    bool changed = false;
     {
         std::lock_guard lock(cache_mutex_);
-        std::string service = path.substr(1, path.find('/', 1) - 1);
-        auto it = service_cache_.find(service);
-        if (it != service_cache_.end()) {
-            auto& instances = it->second;
-            instances.erase(std::remove_if(instances.begin(), instances.end(),
-                                           [&path](const auto& p) { return p.first == path; }),
-                            instances.end());
-            if (instances.empty()) {
-                service_cache_.erase(service);
-            }
-        }
+        changed = UpdateService(service, [&path](ServiceEntry& entry) { return RemoveNode(entry, path); });
         watchers_.erase(path);
     }
+    lock.unlock();
+    if (changed) {
+        NotifyServiceChanged(service);
+    }
 }
 
 void ZookeeperClient::Watch(const std::string& path, std::function<void(std::string)> callback) {
@@ -253,6 +390,26 @@ void ZookeeperClient::Watch(const std::string& path, std::function<void(std::str
     RegisterWatcher(path);
 }
 
+void ZookeeperClient::AddServiceListener(ServiceListener listener) {
+    std::lock_guard lock(listeners_mutex_);
+    listeners_.push_back(std::move(listener));
+}
+
+void ZookeeperClient::NotifyServiceChanged(const std::string& service) {
+    std::vector<ServiceListener> listeners;
+    {
+        std::lock_guard lock(listeners_mutex_);
+        listeners = listeners_;
+    }
+    for (const auto& listener : listeners) {
+        try {
+            listener(service);
+        } catch (const std::exception& e) {
+            XRPC_LOG_WARN("Service listener for {} failed: {}", service, e.what());
+        }
+    }
+}
+
 void ZookeeperClient::RegisterWatcher(const std::string& path) {
     if (!is_connected_ || !zk_handle_) {
         XRPC_LOG_ERROR("ZooKeeper not connected for watcher on {}", path);
@@ -270,47 +427,154 @@ void ZookeeperClient::RegisterWatcher(const std::string& path) {
 }
 
 void ZookeeperClient::Heartbeat() {
-    while (running_ && is_connected_ && zk_handle_) {
-        std::vector<std::string> services;
-        {
-            std::lock_guard lock(cache_mutex_);
-            for (const auto& pair : service_cache_) {
-                services.push_back(pair.first);
-            }
+    // 实例变化由 watch 推送，这里只是兜底：按较长的间隔全量核对已缓存的服务，
+    // 补上 watch 重新设置失败或连接抖动期间漏掉的变化，并重新设置监听
+    std::chrono::milliseconds interval(std::stoll(config_.Get("zookeeper_resync_interval_ms", "30000")));
+    std::unique_lock lock(stop_mutex_);
+    while (running_ && zk_handle_) {
+        if (stop_cv_.wait_for(lock, interval, [this]() { return !running_; })) {
+            break;
+        }
+        if (!is_connected_) {
+            continue;
         }
+        lock.unlock();
 
-        for (const auto& service : services) {
-            String_vector children;
-            std::string service_path = "/" + service;
-            int ret = zoo_get_children(zk_handle_, service_path.c_str(), 0, &children);
-            if (ret != ZOK) {
-                XRPC_LOG_WARN("Failed to get children for {}: {}", service, zerror(ret));
-                continue;
+        for (const auto& pair : *LoadCache()) {
+            SyncService(pair.first);
+        }
+        lock.lock();
+    }
+}
+
+void ZookeeperClient::SyncService(const std::string& service) {
+    bool changed = false;
+    {
+        std::lock_guard sync_lock(sync_mutex_);
+        std::unordered_set<std::string> cached;
+        {
+            std::shared_ptr<const CacheSnapshot> cache = LoadCache();
+            auto it = cache->find(service);
+            if (it == cache->end()) {
+                return; // 未缓存的服务不再跟踪，下次查询时重新加载
+            }
+            for (const auto& node : it->second->nodes) {
+                cached.insert(node.first);
             }
+        }
 
-            std::vector<std::string> current_paths;
+        // 重新设置子节点监听（ZooKeeper 的 watch 是一次性的）并取得当前列表
+        String_vector children;
+        std::string service_path = "/" + service;
+        int ret = zoo_wget_children(zk_handle_, service_path.c_str(), WatcherCallback, this, &children);
+        std::unordered_set<std::string> current;
+        if (ret == ZOK) {
             for (int i = 0; i < children.count; ++i) {
-                current_paths.push_back(service_path + "/" + children.data[i]);
+                current.insert(service_path + "/" + children.data[i]);
             }
             deallocate_String_vector(&children);
+        } else if (ret != ZNONODE) {
+            XRPC_LOG_WARN("Failed to get children for {}: {}", service, zerror(ret));
+            return;
+        }
 
-            std::lock_guard lock(cache_mutex_);
-            auto it = service_cache_.find(service);
-            if (it != service_cache_.end()) {
-                auto& instances = it->second;
-                instances.erase(std::remove_if(instances.begin(), instances.end(),
-                                               [current_paths](const auto& p) {
-                                                   return std::find(current_paths.begin(), current_paths.end(), p.first) == current_paths.end();
-                                               }),
-                                instances.end());
-                if (instances.empty()) {
-                    service_cache_.erase(service);
+        // 只为新增的节点读取数据并设置数据监听
+        std::vector<std::pair<std::string, std::string>> added;
+        for (const auto& path : current) {
+            if (!cached.count(path)) {
+                try {
+                    added.emplace_back(path, GetNodeData(path, true));
+                } catch (const std::exception& e) {
+                    XRPC_LOG_WARN("Failed to get data for {}: {}", path, e.what());
                 }
             }
         }
 
-        // 缩短心跳间隔以优化测试
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        // 整批差异只发布一次快照
+        std::lock_guard lock(cache_mutex_);
+        changed = UpdateService(service, [&](ServiceEntry& entry) {
+            bool modified = false;
+            for (const auto& path : cached) {
+                if (!current.count(path)) {
+                    modified |= RemoveNode(entry, path);
+                }
+            }
+            for (const auto& [path, data] : added) {
+                modified |= UpsertNode(entry, path, data);
+            }
+            return modified;
+        });
+    }
+    if (changed) {
+        XRPC_LOG_DEBUG("Service {} instances updated", service);
+        NotifyServiceChanged(service);
+    }
+}
+
+void ZookeeperClient::HandleNodeEvent(int type, const std::string& node_path) {
+    size_t slash = node_path.find('/', 1);
+    std::string service = node_path.substr(1, slash - 1);
+    if (type == ZOO_CHILD_EVENT) {
+        XRPC_LOG_DEBUG("Child event for {}", node_path);
+        if (slash == std::string::npos) {
+            SyncService(service);
+        }
+        return;
+    }
+
+    std::function<void(std::string)> callback;
+    {
+        std::lock_guard lock(cache_mutex_);
+        auto it = watchers_.find(node_path);
+        if (it != watchers_.end()) {
+            callback = it->second;
+        }
+    }
+    bool tracked = slash != std::string::npos && LoadCache()->count(service) > 0; // 节点属于已缓存的服务
+    if (!callback && !tracked) {
+        XRPC_LOG_DEBUG("No watcher found for node {}", node_path);
+        return;
+    }
+
+    if (type == ZOO_CREATED_EVENT || type == ZOO_CHANGED_EVENT) {
+        std::string data;
+        bool changed = false;
+        try {
+            std::lock_guard sync_lock(sync_mutex_);
+            // 已缓存服务的节点同时重新设置数据监听
+            data = GetNodeData(node_path, tracked);
+            XRPC_LOG_DEBUG("Node {} updated, data: {}", node_path, data);
+            if (tracked) {
+                std::lock_guard lock(cache_mutex_);
+                changed = UpdateService(service, [&](ServiceEntry& entry) { return UpsertNode(entry, node_path, data); });
+            }
+        } catch (const std::exception& e) {
+            XRPC_LOG_ERROR("Failed to handle node event: {}", e.what());
+            return;
+        }
+        if (changed) {
+            NotifyServiceChanged(service);
+        }
+        if (callback) {
+            callback(data);
+            RegisterWatcher(node_path);
+        }
+    } else if (type == ZOO_DELETED_EVENT) {
+        XRPC_LOG_DEBUG("Node {} deleted", node_path);
+        bool changed = false;
+        {
+            std::lock_guard sync_lock(sync_mutex_);
+            std::lock_guard lock(cache_mutex_);
+            changed = UpdateService(service, [&node_path](ServiceEntry& entry) { return RemoveNode(entry, node_path); });
+            watchers_.erase(node_path);
+        }
+        if (changed) {
+            NotifyServiceChanged(service);
+        }
+        if (callback) {
+            callback("");
+            RegisterWatcher(node_path);
+        }
     }
 }
 
@@ -328,97 +592,47 @@ void ZookeeperClient::WatcherCallback(zhandle_t* zh, int type, int state, const
         } else if (state == ZOO_EXPIRED_SESSION_STATE) {
             client->is_connected_ = false;
             XRPC_LOG_ERROR("ZooKeeper session expired");
+            std::shared_ptr<const CacheSnapshot> expired;
             {
                 std::lock_guard lock(client->cache_mutex_);
-                client->service_cache_.clear();
+                expired = client->LoadCache();
+                client->StoreCache(std::make_shared<CacheSnapshot>());
+            }
+            for (const auto& pair : *expired) {
+                client->NotifyServiceChanged(pair.first);
             }
         } else if (state == ZOO_CONNECTING_STATE) {
             client->is_connected_ = false;
             XRPC_LOG_WARN("ZooKeeper session connecting");
         }
-    } else if (path != nullptr) {
-        std::string node_path(path);
-        std::function<void(std::string)> callback;
-        {
-            std::lock_guard lock(client->cache_mutex_);
-            auto it = client->watchers_.find(node_path);
-            if (it != client->watchers_.end()) {
-                callback = it->second;
-            }
-        }
-
-        if (!callback) {
-            XRPC_LOG_DEBUG("No watcher found for node {}", node_path);
-            return;
-        }
-
-        if (type == ZOO_CREATED_EVENT || type == ZOO_CHANGED_EVENT) {
-            try {
-                std::string data = client->GetNodeData(node_path);
-                XRPC_LOG_DEBUG("Node {} updated, data: {}", node_path, data);
-                {
-                    std::lock_guard lock(client->cache_mutex_);
-                    std::string service = node_path.substr(1, node_path.find('/', 1) - 1);
-                    auto& instances = client->service_cache_[service];
-                    auto it = std::find_if(instances.begin(), instances.end(),
-                                           [&node_path](const auto& p) { return p.first == node_path; });
-                    if (it != instances.end()) {
-                        it->second = data;
-                    } else {
-                        instances.emplace_back(node_path, data);
-                    }
-                }
-                callback(data);
-                client->RegisterWatcher(node_path);
-            } catch (const std::exception& e) {
-                XRPC_LOG_ERROR("Failed to handle node event: {}", e.what());
-            }
-        } else if (type == ZOO_DELETED_EVENT) {
-            XRPC_LOG_DEBUG("Node {} deleted", node_path);
-            {
-                std::lock_guard lock(client->cache_mutex_);
-                std::string service = node_path.substr(1, node_path.find('/', 1) - 1);
-                auto it = client->service_cache_.find(service);
-                if (it != client->service_cache_.end()) {
-                    auto& instances = it->second;
-                    instances.erase(std::remove_if(instances.begin(), instances.end(),
-                                                   [&node_path](const auto& p) { return p.first == node_path; }),
-                                    instances.end());
-                    if (instances.empty()) {
-                        client->service_cache_.erase(service);
-                    }
-                }
-                client->watchers_.erase(node_path);
-            }
-            callback("");
-            client->RegisterWatcher(node_path);
-        } else if (type == ZOO_CHILD_EVENT) {
-            XRPC_LOG_DEBUG("Child event for {}", node_path);
-            std::string service = node_path.substr(1, node_path.find('/', 1) - 1);
-            {
-                std::lock_guard lock(client->cache_mutex_);
-                client->service_cache_.erase(service);
-            }
-        }
+    } else if (path != nullptr && *path != '\0') {
+        client->HandleNodeEvent(type, path);
     }
 }
 
-std::string ZookeeperClient::GetNodeData(const std::string& path) {
+std::string ZookeeperClient::GetNodeData(const std::string& path, bool watch) {
     if (!is_connected_ || !zk_handle_) {
         XRPC_LOG_ERROR("ZooKeeper not connected");
         throw std::runtime_error("ZooKeeper not connected");
     }
 
-    char buffer[512];
-    int buffer_len = sizeof(buffer);
-    struct Stat stat;
-    int ret = zoo_get(zk_handle_, path.c_str(), 0, buffer, &buffer_len, &stat);
-    if (ret != ZOK) {
-        XRPC_LOG_ERROR("Failed to get node {}: {}", path, zerror(ret));
-        throw std::runtime_error("Failed to get node: " + std::string(zerror(ret)));
+    // 数百个方法的节点数据可达数 KB；缓冲区不足时按 stat 中的实际长度重读
+    std::string buffer(4096, '\0');
+    while (true) {
+        int buffer_len = static_cast<int>(buffer.size());
+        struct Stat stat;
+        int ret = watch ? zoo_wget(zk_handle_, path.c_str(), WatcherCallback, this, &buffer[0], &buffer_len, &stat)
+                        : zoo_get(zk_handle_, path.c_str(), 0, &buffer[0], &buffer_len, &stat);
+        if (ret != ZOK) {
+            XRPC_LOG_ERROR("Failed to get node {}: {}", path, zerror(ret));
+            throw std::runtime_error("Failed to get node: " + std::string(zerror(ret)));
+        }
+        if (stat.dataLength <= static_cast<int>(buffer.size())) {
+            buffer.resize(buffer_len > 0 ? buffer_len : 0);
+            return buffer;
+        }
+        buffer.resize(stat.dataLength);
     }
-
-    return std::string(buffer, buffer_len);
 }
 
 } // namespace xrpc
\ No newline at end of file
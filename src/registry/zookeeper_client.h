@@ -3,12 +3,15 @@
 
 #include "core/common/xrpc_config.h"
 #include "core/common/xrpc_logger.h"
+#include "registry/service_instance.h"
 #include <zookeeper/zookeeper.h>
 #include <string>
 #include <functional>
 #include <mutex>
 #include <map>
+#include <unordered_map>
 #include <atomic>
+#include <condition_variable>
 #include <vector>
 #include <thread>
 #include <memory>
@@ -24,25 +27,73 @@ public:
     void Stop(); // 新增方法
     void Register(const std::string& path, const std::string& data, bool ephemeral = false);
     std::string Discover(const std::string& path);
-    std::vector<std::pair<std::string, std::string>> DiscoverService(const std::string& service);
-    std::vector<std::string> FindInstancesByMethod(const std::string& service, const std::string& method);
+    // 节点路径和数据
+    using NodeList = std::vector<std::pair<std::string, std::string>>;
+    // 服务的全部实例节点；返回缓存快照中共享的只读列表，已缓存时只读取一次快照指针
+    std::shared_ptr<const NodeList> DiscoverService(const std::string& service);
+    // 提供该方法的实例，按地址排序；返回缓存中共享的只读列表，不提供该方法时为空列表
+    std::shared_ptr<const InstanceList> FindInstancesByMethod(const std::string& service, const std::string& method);
     void Delete(const std::string& path);
     void Watch(const std::string& path, std::function<void(std::string)> callback);
 
+    // 服务的实例缓存发生变化时以服务名回调，不持有内部锁，回调内可以调用 DiscoverService
+    // 在修改缓存的线程上执行（ZooKeeper 事件线程、心跳线程或 Register/Delete 的调用线程）
+    using ServiceListener = std::function<void(const std::string& service)>;
+    void AddServiceListener(ServiceListener listener);
+
 private:
+    // 一个服务的缓存：节点原始数据，以及写入时解析一次建立的方法到实例的倒排索引
+    struct ServiceEntry {
+        NodeList nodes;
+        std::unordered_map<std::string, std::shared_ptr<const InstanceInfo>> instances; // key 为节点路径
+        std::unordered_map<std::string, std::shared_ptr<const InstanceList>> by_method;
+    };
+
+    // 缓存快照：发布后只读，读取方通过 std::atomic_load 取得，不复制，也不争用 mutex_ 等成员锁
+    using CacheSnapshot = std::map<std::string, std::shared_ptr<const ServiceEntry>>;
+
+    // 以下修改一个尚未发布的 ServiceEntry；索引中的列表写时复制，已返回给调用方的列表不受影响
+    // UpsertNode/RemoveNode 返回是否变化
+    static ServiceEntry BuildEntry(NodeList nodes);
+    static bool UpsertNode(ServiceEntry& entry, const std::string& path, const std::string& data);
+    static bool RemoveNode(ServiceEntry& entry, const std::string& path);
+    // instance 为空时从该方法的列表中移除 address
+    static void IndexInstance(ServiceEntry& entry, const std::string& method, const std::string& address,
+                              const std::shared_ptr<const InstanceInfo>& instance);
+
+    // 从快照读取服务，未缓存时加载
+    std::shared_ptr<const ServiceEntry> FindService(const std::string& service);
+    // 服务未缓存时从 ZooKeeper 拉取并设置子节点和各节点的数据监听，调用方持有 mutex_
+    void LoadService(const std::string& service);
+    // 复制已缓存服务的条目交给 update 修改，update 返回 true 时发布新快照（条目为空则移除该服务）
+    // 调用方持有 cache_mutex_；服务未缓存时返回 false
+    bool UpdateService(const std::string& service, const std::function<bool(ServiceEntry&)>& update);
+    std::shared_ptr<const CacheSnapshot> LoadCache() const;
+    void StoreCache(std::shared_ptr<const CacheSnapshot> snapshot);
+    // 将已缓存服务的实例列表与 ZooKeeper 对比，按差异增删节点并重新设置子节点监听
+    void SyncService(const std::string& service);
+    // 处理节点路径上的 watch 事件：更新缓存并调用 Watch 注册的回调
+    void HandleNodeEvent(int type, const std::string& node_path);
     void Heartbeat();
-    std::string GetNodeData(const std::string& path);
+    // watch 为 true 时同时设置数据监听
+    std::string GetNodeData(const std::string& path, bool watch = false);
     void RegisterWatcher(const std::string& path);
+    void NotifyServiceChanged(const std::string& service);
     static void WatcherCallback(zhandle_t* zh, int type, int state, const char* path, void* context);
 
     zhandle_t* zk_handle_;
     std::atomic<bool> is_connected_;
     std::atomic<bool> running_;
     XrpcConfig config_;
-    std::mutex cache_mutex_;
+    std::mutex cache_mutex_; // 串行化缓存快照的发布，保护 watchers_
     std::mutex mutex_;
-    std::map<std::string, std::vector<std::pair<std::string, std::string>>> service_cache_;
+    std::mutex sync_mutex_; // 串行化以 ZooKeeper 当前状态更新缓存的过程（加载、事件、定期核对）
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_; // Stop 时唤醒定期核对线程
+    std::shared_ptr<const CacheSnapshot> cache_; // 通过 std::atomic_load/atomic_store 访问
     std::map<std::string, std::function<void(std::string)>> watchers_;
+    std::mutex listeners_mutex_;
+    std::vector<ServiceListener> listeners_;
     std::thread heartbeat_thread_;
 };
 
@@ -1,105 +1,415 @@
 #include "transport/asio_transport.h"
 #include "core/common/xrpc_logger.h"
 #include <boost/asio.hpp>
+#include <algorithm>
+#include <condition_variable>
 #include <stdexcept>
 #include <thread>
 #include <memory>
+#include <cerrno>
+#include <poll.h>
 
 namespace xrpc {
 
-AsioTransport::AsioTransport() : io_context_(new boost::asio::io_context), response_received_(false) {
-    // 创建 io_context::work，防止 io_context 提前退出
-    work_ = std::make_unique<boost::asio::io_context::work>(*io_context_);
-    // 启动单独线程运行 io_context
-    io_context_thread_ = std::thread([this]() { io_context_->run(); });
+using SocketError = boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_ERROR>;
+
+#ifdef SO_REUSEPORT
+using ReusePort = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+AsioTransport::AsioTransport(size_t io_threads, IoContextPool::Balance balance)
+    : io_pool_(new IoContextPool(io_threads, balance)), default_port_(0),
+      pool_min_connections_(1), pool_max_connections_(1), reuse_port_(false),
+      write_high_water_mark_(kDefaultWriteHighWaterMark) {
+    for (size_t i = 0; i < io_pool_->Size(); ++i) {
+        timer_wheels_.emplace_back(new TimerWheel(io_pool_->GetIoContext(i), kTimerWheelTick, kTimerWheelSlots,
+                                                  [this](uint64_t request_id) { ExpireCall(request_id); }));
+    }
 }
 
 AsioTransport::~AsioTransport() {
     Stop();
-    if (io_context_thread_.joinable()) {
-        io_context_thread_.join();
-    }
 }
 
 void AsioTransport::Connect(const std::string& ip, int port) {
-    std::lock_guard<std::mutex> lock(socket_mutex_);
-    if (!client_socket_ || !client_socket_->is_open()) {
-        client_socket_ = std::make_shared<boost::asio::ip::tcp::socket>(*io_context_);
-        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(ip), port);
-        
-        boost::system::error_code ec;
-        client_socket_->connect(endpoint, ec);
-        if (ec) {
-            XRPC_LOG_ERROR("Failed to connect to {}:{}: {}", ip, port, ec.message());
-            throw std::runtime_error("Connection failed");
-        }
-        XRPC_LOG_INFO("Connected to {}:{}", ip, port);
+    if (!Checkout(ip, port)) {
+        throw std::runtime_error("Connection failed");
     }
+    std::lock_guard<std::mutex> lock(pools_mutex_);
+    default_ip_ = ip;
+    default_port_ = port;
 }
 
-void AsioTransport::StartServer(const std::string& ip, int port, std::function<void(const std::string&, std::string&)> callback) {
-    server_callback_ = callback;
-    server_acceptor_ = std::make_unique<boost::asio::ip::tcp::acceptor>(
-        *io_context_, 
-        boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(ip), port)
-    );
-    DoAccept();
-    XRPC_LOG_INFO("Server started at {}:{}", ip, port);
+void AsioTransport::SetConnectionPoolSize(size_t min_connections, size_t max_connections) {
+    min_connections = std::max<size_t>(1, min_connections);
+    pool_min_connections_ = min_connections;
+    pool_max_connections_ = std::max(min_connections, max_connections);
 }
 
-bool AsioTransport::Send(const std::string& data, std::string& response) {
-    std::lock_guard<std::mutex> lock(socket_mutex_);
-    if (!client_socket_ || !client_socket_->is_open()) {
-        XRPC_LOG_ERROR("Client socket not connected");
-        return false;
+size_t AsioTransport::PoolSize(const std::string& ip, int port) {
+    EndpointPool* pool = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        auto it = endpoint_pools_.find(ip + ":" + std::to_string(port));
+        if (it == endpoint_pools_.end()) {
+            return 0;
+        }
+        pool = it->second.get();
     }
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    return pool->connections.size();
+}
 
-    response_received_ = false;
-    
+std::shared_ptr<Connection> AsioTransport::NewClientConnection(const std::string& ip, int port) {
+    // 新连接按均衡策略分散到各个 reactor
+    size_t reactor_index = io_pool_->Next();
+    boost::asio::ip::tcp::socket socket(io_pool_->GetIoContext(reactor_index));
     boost::system::error_code ec;
-    boost::asio::write(*client_socket_, boost::asio::buffer(data), ec);
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(ip, ec), port);
+    if (!ec) {
+        socket.open(endpoint.protocol(), ec);
+    }
+    if (!ec) {
+        // 非阻塞发起连接并用 poll 等待，对端无响应时不会卡住调用线程直到内核超时
+        socket.non_blocking(true, ec);
+        socket.connect(endpoint, ec);
+        if (ec == boost::asio::error::in_progress || ec == boost::asio::error::would_block) {
+            pollfd pfd{socket.native_handle(), POLLOUT, 0};
+            int ready = ::poll(&pfd, 1, static_cast<int>(kConnectTimeout.count()));
+            if (ready == 0) {
+                ec = boost::asio::error::timed_out;
+            } else if (ready < 0) {
+                ec.assign(errno, boost::system::system_category());
+            } else {
+                SocketError error;
+                socket.get_option(error, ec);
+                if (!ec && error.value() != 0) {
+                    ec.assign(error.value(), boost::system::system_category());
+                }
+            }
+        }
+    }
+    if (!ec) {
+        socket.non_blocking(false, ec);
+    }
     if (ec) {
-        XRPC_LOG_ERROR("Failed to send data: {}", ec.message());
-        return false;
+        XRPC_LOG_ERROR("Failed to connect to {}:{}: {}", ip, port, ec.message());
+        return nullptr;
+    }
+    socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    auto conn = std::make_shared<Connection>(std::move(socket), reactor_index);
+    io_pool_->AddLoad(reactor_index, 1); // 由 FailPendingCalls 归还
+    // 每个连接只有一个常驻读循环，负责分发所有响应
+    boost::asio::post(conn->socket.get_executor(), [this, conn]() { DoClientRead(conn); });
+    XRPC_LOG_INFO("Connected to {}:{}", ip, port);
+    return conn;
+}
+
+EndpointPool* AsioTransport::GetEndpointPool(const std::string& ip, int port) {
+    std::lock_guard<std::mutex> lock(pools_mutex_);
+    auto& entry = endpoint_pools_[ip + ":" + std::to_string(port)];
+    if (!entry) {
+        entry.reset(new EndpointPool(ip, port));
+    }
+    return entry.get();
+}
+
+std::shared_ptr<Connection> AsioTransport::Checkout(EndpointPool* pool) {
+    size_t min_connections = pool_min_connections_.load(std::memory_order_relaxed);
+    size_t max_connections = pool_max_connections_.load(std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    auto& connections = pool->connections;
+    for (;;) {
+        // 剔除已断开的连接，它们的未完成请求已由读循环结束
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                         [](const std::shared_ptr<Connection>& conn) { return conn->closed.load(); }),
+                          connections.end());
+        if (connections.empty() && pool->connecting > 0) {
+            // 其他线程正在建连，等它完成，不重复建连
+            pool->connected_cv.wait(lock);
+            continue;
+        }
+
+        std::shared_ptr<Connection> best;
+        for (const auto& conn : connections) {
+            if (!best ||
+                conn->inflight.load(std::memory_order_relaxed) < best->inflight.load(std::memory_order_relaxed)) {
+                best = conn;
+            }
+        }
+        // 不足最小连接数，或所有连接都已繁忙时才扩容，避免空闲时占用过多连接
+        size_t total = connections.size() + pool->connecting;
+        bool grow = total < min_connections ||
+                    (total < max_connections &&
+                     (!best || best->inflight.load(std::memory_order_relaxed) >= kPoolGrowThreshold));
+        if (!grow || std::chrono::steady_clock::now() < pool->retry_at) {
+            return best;
+        }
+
+        // 建连可能耗时数秒，期间不持有锁，其他调用仍可使用已有连接
+        ++pool->connecting;
+        lock.unlock();
+        auto conn = NewClientConnection(pool->ip, pool->port);
+        lock.lock();
+        --pool->connecting;
+        pool->connected_cv.notify_all();
+        if (!conn) {
+            pool->backoff = pool->backoff.count() == 0 ? kConnectRetryMin
+                                                       : std::min(pool->backoff * 2, kConnectRetryMax);
+            pool->retry_at = std::chrono::steady_clock::now() + pool->backoff;
+            XRPC_LOG_WARN("{}:{} marked unhealthy, retry in {} ms", pool->ip, pool->port, pool->backoff.count());
+            return best;
+        }
+        pool->backoff = std::chrono::milliseconds(0);
+        pool->retry_at = std::chrono::steady_clock::time_point();
+        connections.push_back(conn);
+    }
+}
+
+void AsioTransport::StartServer(const std::string& ip, int port, ServerCallback callback, bool reuse_port) {
+    // 每个请求独立派发到 reactor 池并发处理，慢请求不会阻塞同一连接上的后续请求
+    StartAsyncServer(ip, port, [this, callback](FrameView request, Responder respond) {
+        Post([callback, request = std::move(request), respond = std::move(respond)]() {
+            std::string response;
+            callback(request.View(), response);
+            respond(response.empty() ? std::string() : FrameBuffer::Pack(response));
+        });
+    }, reuse_port);
+}
+
+void AsioTransport::StartAsyncServer(const std::string& ip, int port, AsyncServerCallback callback, bool reuse_port) {
+    StartCancellableServer(ip, port, [callback](FrameView request, Responder respond) {
+        callback(std::move(request), std::move(respond));
+        return CancelHook();
+    }, reuse_port);
+}
+
+void AsioTransport::StartCancellableServer(const std::string& ip, int port, CancellableServerCallback callback,
+                                           bool reuse_port) {
+    server_callback_ = callback;
+#ifndef SO_REUSEPORT
+    if (reuse_port) {
+        XRPC_LOG_WARN("SO_REUSEPORT not supported, fallback to single acceptor");
+        reuse_port = false;
+    }
+#endif
+    reuse_port_ = reuse_port;
+
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(ip), port);
+    size_t acceptor_count = reuse_port_ ? io_pool_->Size() : 1;
+    for (size_t i = 0; i < acceptor_count; ++i) {
+        // reuse_port 模式下第 i 个 acceptor 属于第 i 个 reactor，接受的连接无需跨线程移交
+        auto acceptor = std::make_unique<boost::asio::ip::tcp::acceptor>(io_pool_->GetIoContext(i));
+        acceptor->open(endpoint.protocol());
+        acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+        if (reuse_port_) {
+            acceptor->set_option(ReusePort(true));
+        }
+#endif
+        acceptor->bind(endpoint);
+        acceptor->listen();
+        server_acceptors_.push_back(std::move(acceptor));
+    }
+    for (size_t i = 0; i < server_acceptors_.size(); ++i) {
+        DoAccept(i);
+    }
+    XRPC_LOG_INFO("Server started at {}:{} with {} acceptor(s)", ip, port, server_acceptors_.size());
+}
+
+bool AsioTransport::Send(uint64_t request_id, const std::string& data, std::string& response) {
+    std::string ip;
+    int port;
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        ip = default_ip_;
+        port = default_port_;
+    }
+    return Send(ip, port, request_id, data, response);
+}
+
+void AsioTransport::SendAsync(uint64_t request_id, const std::string& data, ResponseCallback callback) {
+    std::string ip;
+    int port;
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        ip = default_ip_;
+        port = default_port_;
     }
-    XRPC_LOG_DEBUG("Sent {} bytes", data.size());
+    SendAsync(ip, port, request_id, data, std::move(callback));
+}
+
+bool AsioTransport::Send(const std::string& ip, int port, uint64_t request_id, const std::string& data,
+                         std::string& response) {
+    return SendFrame(ip, port, request_id, FrameBuffer::Pack(data), response) == CallStatus::OK;
+}
 
-    DoClientRead();
-    while (!response_received_ && !ec) {
-        io_context_->poll_one();
+void AsioTransport::SendAsync(const std::string& ip, int port, uint64_t request_id, const std::string& data,
+                              ResponseCallback callback) {
+    SendFrameAsync(ip, port, request_id, FrameBuffer::Pack(data),
+                   [callback = std::move(callback)](const std::string& response, CallStatus status) {
+                       callback(response, status == CallStatus::OK);
+                   });
+}
+
+CallStatus AsioTransport::SendFrame(const std::string& ip, int port, uint64_t request_id, std::string frame,
+                                    std::string& response, std::chrono::milliseconds timeout) {
+    return SendFrame(GetEndpointPool(ip, port), request_id, std::move(frame), response, timeout);
+}
+
+void AsioTransport::SendFrameAsync(const std::string& ip, int port, uint64_t request_id, std::string frame,
+                                   CallCallback callback, std::chrono::milliseconds timeout) {
+    SendFrameAsync(GetEndpointPool(ip, port), request_id, std::move(frame), std::move(callback), timeout);
+}
+
+CallStatus AsioTransport::SendFrame(EndpointPool* pool, uint64_t request_id, std::string frame,
+                                    std::string& response, std::chrono::milliseconds timeout) {
+    if (io_pool_->RunningInThisThread()) {
+        // 在响应回调或投递的任务里阻塞等待，会卡住本 reactor 上所有连接的读循环，承载这次响应的连接也可能在其中；
+        // 也不能在本线程嵌套驱动 io_context，直接失败
+        XRPC_LOG_ERROR("Synchronous call {} issued on a reactor thread, use SendFrameAsync instead", request_id);
+        return CallStatus::FAILED;
+    }
+    auto conn = Checkout(pool);
+    if (!conn) {
+        XRPC_LOG_ERROR("Client socket not connected");
+        return CallStatus::FAILED;
     }
-    if (!response_received_) {
+
+    // 每个调用有独立的完成通知，调用线程只等待自己的响应，不占用 reactor
+    struct SyncState {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+        CallStatus status = CallStatus::FAILED;
+        std::string response;
+    };
+    auto state = std::make_shared<SyncState>();
+    StartCall(conn, request_id, std::move(frame), [state](const std::string& response_data, CallStatus status) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->response = response_data;
+        state->status = status;
+        state->done = true;
+        state->cv.notify_one();
+    }, timeout);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state] { return state->done; });
+    if (state->status != CallStatus::OK) {
         XRPC_LOG_ERROR("No response received");
-        return false;
+        return state->status;
     }
 
-    response = response_;
-    return true;
+    response = std::move(state->response);
+    return CallStatus::OK;
 }
 
-void AsioTransport::SendAsync(const std::string& data, std::function<void(const std::string&, bool)> callback) {
-    std::lock_guard<std::mutex> lock(socket_mutex_);
-    if (!client_socket_ || !client_socket_->is_open()) {
+void AsioTransport::SendFrameAsync(EndpointPool* pool, uint64_t request_id, std::string frame,
+                                   CallCallback callback, std::chrono::milliseconds timeout) {
+    auto conn = Checkout(pool);
+    if (!conn) {
         XRPC_LOG_ERROR("Client socket not connected");
-        callback("", false);
+        callback("", CallStatus::FAILED);
         return;
     }
+    StartCall(conn, request_id, std::move(frame), std::move(callback), timeout);
+}
 
-    // 为每次异步调用分配独立的缓冲区
-    auto read_buffer = std::make_shared<std::array<char, 8192>>();
-    boost::asio::async_write(
-        *client_socket_,
-        boost::asio::buffer(data),
-        [this, callback, read_buffer, data](const boost::system::error_code& ec, std::size_t /*bytes_transferred*/) {
-            if (ec) {
-                XRPC_LOG_ERROR("Failed to send async data: {}", ec.message());
-                callback("", false);
-                return;
+void AsioTransport::StartCall(std::shared_ptr<Connection> conn, uint64_t request_id,
+                              std::string frame, CallCallback callback, std::chrono::milliseconds timeout) {
+    // 先登记再发送，避免响应先于登记到达
+    bool registered = false;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (!conn->closed) {
+            pending_calls_[request_id] = PendingCall{conn, std::move(callback)};
+            conn->inflight.fetch_add(1, std::memory_order_relaxed);
+            registered = true;
+        }
+    }
+    if (!registered) { // 连接已被读循环关闭
+        callback("", CallStatus::FAILED);
+        return;
+    }
+    // 帧头写入调用方预留的空间，payload 不再复制
+    FrameBuffer::EncodeHeader(static_cast<uint32_t>(frame.size() - FrameBuffer::kHeaderSize), request_id, &frame[0]);
+    auto shared_frame = std::make_shared<std::string>(std::move(frame));
+    boost::asio::post(conn->socket.get_executor(), [this, conn, shared_frame, request_id, timeout]() {
+        if (timeout.count() > 0) {
+            // 记下槽位，调用提前结束时据此删除；此前已结束（连接断开或被取消）则立即删除
+            TimerWheel& wheel = *timer_wheels_[conn->reactor_index];
+            size_t slot = wheel.Add(request_id, timeout);
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto it = pending_calls_.find(request_id);
+            if (it != pending_calls_.end() && it->second.conn == conn) {
+                it->second.timer_slot = slot;
+            } else {
+                wheel.Remove(request_id, slot);
             }
-            XRPC_LOG_DEBUG("Sent {} bytes async", data.size());
-            DoClientAsyncRead(read_buffer, callback);
         }
-    );
+        EnqueueFrame(conn, shared_frame);
+    });
+}
+
+void AsioTransport::RemoveTimer(const std::shared_ptr<Connection>& conn, uint64_t request_id, size_t timer_slot) {
+    if (timer_slot == TimerWheel::kNoSlot) {
+        return;
+    }
+    // 时间轮只在所属 reactor 上访问
+    TimerWheel* wheel = timer_wheels_[conn->reactor_index].get();
+    if (io_pool_->GetIoContext(conn->reactor_index).get_executor().running_in_this_thread()) {
+        wheel->Remove(request_id, timer_slot);
+    } else {
+        boost::asio::post(conn->socket.get_executor(),
+                          [wheel, request_id, timer_slot]() { wheel->Remove(request_id, timer_slot); });
+    }
+}
+
+void AsioTransport::ExpireCall(uint64_t request_id) {
+    CallCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        auto it = pending_calls_.find(request_id);
+        if (it == pending_calls_.end()) {
+            return;
+        }
+        callback = std::move(it->second.callback);
+        it->second.conn->inflight.fetch_sub(1, std::memory_order_relaxed);
+        pending_calls_.erase(it);
+    }
+    XRPC_LOG_WARN("Request {} timed out", request_id);
+    callback("", CallStatus::TIMEOUT);
+}
+
+void AsioTransport::CancelCall(uint64_t request_id) {
+    PendingCall call;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        auto it = pending_calls_.find(request_id);
+        if (it == pending_calls_.end()) {
+            return; // 已完成、超时或已取消
+        }
+        call = std::move(it->second);
+        call.conn->inflight.fetch_sub(1, std::memory_order_relaxed);
+        pending_calls_.erase(it);
+    }
+    // 通知服务端停止处理；服务端之后仍可能回复，响应按未知 request_id 丢弃
+    auto frame = std::make_shared<std::string>(FrameBuffer::PackCancel(request_id));
+    auto conn = call.conn;
+    RemoveTimer(conn, request_id, call.timer_slot);
+    boost::asio::post(conn->socket.get_executor(), [this, conn, frame]() { EnqueueFrame(conn, frame); });
+    XRPC_LOG_INFO("Request {} canceled", request_id);
+    call.callback("", CallStatus::CANCELLED);
+}
+
+void AsioTransport::Post(std::function<void()> task) {
+    // 任务单独轮询，不用连接分配策略：LEAST_LOAD 按连接数选择，投递任务不改变连接数，所有任务会落到同一个 reactor
+    size_t index = next_task_.fetch_add(1, std::memory_order_relaxed) % io_pool_->Size();
+    if (io_pool_->Size() > 1 && io_pool_->GetIoContext(index).get_executor().running_in_this_thread()) {
+        // 不投递回调用方所在的 reactor，否则任务会排在该 reactor 的读循环前面，阻塞其连接上的后续请求
+        index = next_task_.fetch_add(1, std::memory_order_relaxed) % io_pool_->Size();
+    }
+    boost::asio::post(io_pool_->GetIoContext(index), std::move(task));
 }
 
 void AsioTransport::Run() {
@@ -107,139 +417,326 @@ void AsioTransport::Run() {
 }
 
 void AsioTransport::Stop() {
+    // 先停止所有 reactor，之后的关闭操作不会与 I/O 线程并发
+    io_pool_->Stop();
+    for (auto& wheel : timer_wheels_) {
+        wheel->Stop();
+    }
+
     boost::system::error_code ec;
+    std::vector<std::shared_ptr<Connection>> client_conns;
     {
-        std::lock_guard<std::mutex> lock(socket_mutex_);
-        if (client_socket_ && client_socket_->is_open()) {
-            client_socket_->close(ec);
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        for (auto& entry : endpoint_pools_) {
+            std::lock_guard<std::mutex> pool_lock(entry.second->mutex);
+            client_conns.insert(client_conns.end(), entry.second->connections.begin(),
+                                entry.second->connections.end());
+        }
+    }
+    for (auto& conn : client_conns) {
+        if (conn->socket.is_open()) {
+            conn->socket.close(ec);
             if (ec) {
                 XRPC_LOG_ERROR("Failed to close client socket: {}", ec.message());
             }
         }
     }
-    if (server_acceptor_ && server_acceptor_->is_open()) {
-        server_acceptor_->cancel(ec);
+    for (auto& acceptor : server_acceptors_) {
+        if (!acceptor->is_open()) {
+            continue;
+        }
+        acceptor->cancel(ec);
         if (ec) {
             XRPC_LOG_ERROR("Failed to cancel acceptor: {}", ec.message());
         }
-        server_acceptor_->close(ec);
+        acceptor->close(ec);
         if (ec) {
             XRPC_LOG_ERROR("Failed to close server acceptor: {}", ec.message());
         }
     }
-    for (auto& socket : server_sockets_) {
-        if (socket && socket->is_open()) {
-            socket->cancel(ec);
+    std::set<std::shared_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(server_connections_);
+    }
+    for (auto& conn : connections) {
+        if (conn && conn->socket.is_open()) {
+            conn->socket.cancel(ec);
             if (ec) {
                 XRPC_LOG_ERROR("Failed to cancel server socket: {}", ec.message());
             }
-            socket->close(ec);
+            conn->socket.close(ec);
             if (ec) {
                 XRPC_LOG_ERROR("Failed to close server socket: {}", ec.message());
             }
         }
     }
-    server_sockets_.clear();
-    work_.reset();
-    io_context_->stop();
+    for (auto& conn : client_conns) {
+        FailPendingCalls(conn);
+    }
 }
 
-void AsioTransport::DoClientRead() {
-    client_socket_->async_read_some(
-        boost::asio::buffer(read_buffer_, sizeof(read_buffer_)),
-        [this](const boost::system::error_code& ec, std::size_t bytes_transferred) {
-            HandleClientRead(ec, bytes_transferred);
+void AsioTransport::EnqueueFrame(std::shared_ptr<Connection> conn, std::shared_ptr<std::string> frame) {
+    if (conn->closed) {
+        return;
+    }
+    conn->write_queue_bytes += frame->size();
+    conn->write_queue.push_back(std::move(frame));
+    if (!conn->writing) {
+        DoWrite(conn);
+    }
+}
+
+void AsioTransport::DoWrite(std::shared_ptr<Connection> conn) {
+    if (conn->write_queue.empty() || conn->closed) {
+        conn->writing = false;
+        return;
+    }
+    conn->writing = true;
+    // 把队列中已有的帧一次性聚合发送，减少系统调用次数
+    auto frames = std::make_shared<std::vector<std::shared_ptr<std::string>>>(
+        conn->write_queue.begin(), conn->write_queue.end());
+    conn->write_queue.clear();
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(frames->size());
+    for (const auto& frame : *frames) {
+        buffers.push_back(boost::asio::buffer(*frame));
+    }
+    boost::asio::async_write(
+        conn->socket,
+        buffers,
+        [this, conn, frames](const boost::system::error_code& ec, std::size_t bytes_transferred) {
+            if (ec) {
+                XRPC_LOG_ERROR("Failed to send async data: {}", ec.message());
+                conn->writing = false;
+                if (conn->read_paused) { // 读循环已暂停，无法感知错误
+                    CloseServerConnection(conn);
+                    return;
+                }
+                boost::system::error_code close_ec;
+                conn->socket.close(close_ec); // 由读循环感知错误并结束未完成请求
+                return;
+            }
+            XRPC_LOG_DEBUG("Sent {} frames, {} bytes async", frames->size(), bytes_transferred);
+            conn->write_queue_bytes -= bytes_transferred;
+            if (conn->read_paused && conn->write_queue_bytes <= write_high_water_mark_ / 2) {
+                XRPC_LOG_DEBUG("Write backlog drained to {} bytes, resume reading", conn->write_queue_bytes);
+                conn->read_paused = false;
+                DoServerRead(conn);
+            }
+            DoWrite(conn);
         }
     );
 }
 
-void AsioTransport::HandleClientRead(const boost::system::error_code& ec, std::size_t bytes_transferred) {
-    if (!ec) {
-        response_.assign(read_buffer_, bytes_transferred);
-        response_received_ = true;
-        XRPC_LOG_DEBUG("Received {} bytes", bytes_transferred);
-    } else {
+void AsioTransport::DoClientRead(std::shared_ptr<Connection> conn) {
+    char* write_ptr = conn->read_buffer.PrepareWrite();
+    conn->socket.async_read_some(
+        boost::asio::buffer(write_ptr, conn->read_buffer.WritableBytes()),
+        [this, conn](const boost::system::error_code& ec, std::size_t bytes_transferred) {
+            HandleClientRead(conn, ec, bytes_transferred);
+        }
+    );
+}
+
+void AsioTransport::HandleClientRead(std::shared_ptr<Connection> conn,
+                                    const boost::system::error_code& ec,
+                                    std::size_t bytes_transferred) {
+    if (ec) {
         XRPC_LOG_ERROR("Read error: {}", ec.message());
+        FailPendingCalls(conn);
+        return;
     }
-}
+    conn->read_buffer.CommitWrite(bytes_transferred);
+    XRPC_LOG_DEBUG("Received {} bytes", bytes_transferred);
 
-void AsioTransport::DoClientAsyncRead(std::shared_ptr<std::array<char, 8192>> read_buffer,
-                                     std::function<void(const std::string&, bool)> callback) {
-    client_socket_->async_read_some(
-        boost::asio::buffer(*read_buffer),
-        [this, read_buffer, callback](const boost::system::error_code& ec, std::size_t bytes_transferred) {
-            HandleClientAsyncRead(read_buffer, callback, ec, bytes_transferred);
+    std::string response;
+    uint64_t request_id = 0;
+    while (conn->read_buffer.NextFrame(&response, &request_id)) {
+        CallCallback callback;
+        size_t timer_slot = TimerWheel::kNoSlot;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto it = pending_calls_.find(request_id);
+            if (it != pending_calls_.end()) {
+                callback = std::move(it->second.callback);
+                timer_slot = it->second.timer_slot;
+                it->second.conn->inflight.fetch_sub(1, std::memory_order_relaxed);
+                pending_calls_.erase(it);
+            }
         }
-    );
+        if (callback) {
+            // 本线程即连接所属 reactor，超时任务直接删除，时间轮空后不再唤醒
+            timer_wheels_[conn->reactor_index]->Remove(request_id, timer_slot);
+            callback(response, CallStatus::OK);
+        } else {
+            // 已超时的请求的迟到响应也在这里丢弃
+            XRPC_LOG_WARN("Dropped response for unknown request_id {}", request_id);
+        }
+    }
+    if (conn->read_buffer.HasError()) {
+        FailPendingCalls(conn);
+        return;
+    }
+    DoClientRead(conn);
 }
 
-void AsioTransport::HandleClientAsyncRead(std::shared_ptr<std::array<char, 8192>> read_buffer,
-                                         std::function<void(const std::string&, bool)> callback,
-                                         const boost::system::error_code& ec,
-                                         std::size_t bytes_transferred) {
-    if (!ec) {
-        std::string response(read_buffer->data(), bytes_transferred);
-        XRPC_LOG_DEBUG("Received {} bytes async", bytes_transferred);
-        callback(response, true);
-    } else {
-        XRPC_LOG_ERROR("Async read error: {}", ec.message());
-        callback("", false);
+void AsioTransport::FailPendingCalls(std::shared_ptr<Connection> conn) {
+    // 读循环与 Stop 都可能调用，只有第一次归还 reactor 负载
+    if (!conn->closed.exchange(true)) {
+        io_pool_->AddLoad(conn->reactor_index, -1);
+    }
+    boost::system::error_code ec;
+    conn->socket.close(ec);
+
+    std::vector<CallCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        for (auto it = pending_calls_.begin(); it != pending_calls_.end();) {
+            if (it->second.conn == conn) {
+                callbacks.push_back(std::move(it->second.callback));
+                RemoveTimer(conn, it->first, it->second.timer_slot);
+                conn->inflight.fetch_sub(1, std::memory_order_relaxed);
+                it = pending_calls_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& callback : callbacks) {
+        callback("", CallStatus::FAILED);
     }
 }
 
-void AsioTransport::DoAccept() {
-    if (!server_acceptor_ || !server_acceptor_->is_open()) {
+void AsioTransport::DoAccept(size_t acceptor_index) {
+    auto& acceptor = server_acceptors_[acceptor_index];
+    if (!acceptor->is_open()) {
         return;
     }
-    auto socket = std::make_shared<boost::asio::ip::tcp::socket>(*io_context_);
-    server_acceptor_->async_accept(
-        *socket,
-        [this, socket](const boost::system::error_code& ec) {
-            HandleAccept(socket, ec);
+    // 新连接直接建立在选中的 reactor 上；reuse_port 模式下留在 acceptor 自己的 reactor
+    size_t reactor_index = reuse_port_ ? acceptor_index : io_pool_->Next();
+    acceptor->async_accept(
+        io_pool_->GetIoContext(reactor_index),
+        [this, acceptor_index, reactor_index](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket) {
+            HandleAccept(acceptor_index, reactor_index, ec, std::move(socket));
         }
     );
 }
 
-void AsioTransport::HandleAccept(std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::system::error_code& ec) {
+void AsioTransport::HandleAccept(size_t acceptor_index, size_t reactor_index, const boost::system::error_code& ec,
+                                 boost::asio::ip::tcp::socket socket) {
     if (!ec) {
-        XRPC_LOG_INFO("Client connected: {}", socket->remote_endpoint().address().to_string());
-        server_sockets_.insert(socket);
-        DoServerRead(socket);
+        auto conn = std::make_shared<Connection>(std::move(socket), reactor_index);
+        boost::system::error_code endpoint_ec;
+        auto remote = conn->socket.remote_endpoint(endpoint_ec);
+        XRPC_LOG_INFO("Client connected: {}", endpoint_ec ? "unknown" : remote.address().to_string());
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            server_connections_.insert(conn);
+        }
+        io_pool_->AddLoad(reactor_index, 1);
+        // 读循环交给连接所属的 reactor 线程
+        boost::asio::post(conn->socket.get_executor(), [this, conn]() { DoServerRead(conn); });
     } else {
         XRPC_LOG_ERROR("Accept error: {}", ec.message());
+        if (ec == boost::asio::error::operation_aborted) {
+            return;
+        }
     }
-    DoAccept();
+    DoAccept(acceptor_index);
 }
 
-void AsioTransport::DoServerRead(std::shared_ptr<boost::asio::ip::tcp::socket> socket) {
-    auto read_buffer = std::make_shared<std::array<char, 8192>>(); // 每个连接独立的缓冲区
-    socket->async_read_some(
-        boost::asio::buffer(*read_buffer),
-        [this, socket, read_buffer](const boost::system::error_code& ec, std::size_t bytes_transferred) {
-            HandleServerRead(socket, read_buffer, ec, bytes_transferred);
+void AsioTransport::DoServerRead(std::shared_ptr<Connection> conn) {
+    char* write_ptr = conn->read_buffer.PrepareWrite();
+    conn->socket.async_read_some(
+        boost::asio::buffer(write_ptr, conn->read_buffer.WritableBytes()),
+        [this, conn](const boost::system::error_code& ec, std::size_t bytes_transferred) {
+            HandleServerRead(conn, ec, bytes_transferred);
         }
     );
 }
 
-void AsioTransport::HandleServerRead(std::shared_ptr<boost::asio::ip::tcp::socket> socket, 
-                                    std::shared_ptr<std::array<char, 8192>> read_buffer,
+void AsioTransport::HandleServerRead(std::shared_ptr<Connection> conn,
                                     const boost::system::error_code& ec, 
                                     std::size_t bytes_transferred) {
-    if (!ec) {
-        std::string request(read_buffer->data(), bytes_transferred);
-        std::string response;
-        if (server_callback_) {
-            server_callback_(request, response);
+    if (ec) {
+        XRPC_LOG_INFO("Client disconnected: {}", ec.message());
+        CloseServerConnection(conn);
+        return;
+    }
+
+    conn->read_buffer.CommitWrite(bytes_transferred);
+    // 一次读取可能包含零个或多个完整帧
+    FrameView request;
+    uint64_t request_id = 0;
+    while (conn->read_buffer.NextFrame(&request, &request_id)) {
+        if (request.size == 0) {
+            CancelServerCall(conn, request_id);
+            continue;
         }
-        if (!response.empty()) {
-            boost::asio::write(*socket, boost::asio::buffer(response));
-            XRPC_LOG_DEBUG("Sent {} bytes to {}", response.size(), socket->remote_endpoint().address().to_string());
+        // request 引用接收缓冲块，处理结束前缓冲块不会被释放或覆盖；响应带原 request_id，完成即写回
+        CancelHook hook = server_callback_(std::move(request), [this, conn, request_id](std::string frame) {
+            SendResponse(conn, request_id, std::move(frame));
+        });
+        if (hook) {
+            // 回复总是投递到本 reactor 执行，因此注销一定发生在登记之后
+            conn->cancel_hooks[request_id] = std::move(hook);
         }
-        DoServerRead(socket); // 继续读取下一条消息
-    } else {
-        XRPC_LOG_INFO("Client disconnected: {}", socket->remote_endpoint().address().to_string());
-        server_sockets_.erase(socket);
+    }
+    if (conn->read_buffer.HasError()) {
+        CloseServerConnection(conn);
+        return;
+    }
+    if (write_high_water_mark_ > 0 && conn->write_queue_bytes > write_high_water_mark_) {
+        // 对端读取太慢，暂停读取直到发送队列回落，由 DoWrite 恢复
+        XRPC_LOG_WARN("Write backlog {} bytes exceeds high water mark, pause reading", conn->write_queue_bytes);
+        conn->read_paused = true;
+        return;
+    }
+    DoServerRead(conn); // 继续读取下一条消息
+}
+
+void AsioTransport::SendResponse(std::shared_ptr<Connection> conn, uint64_t request_id, std::string frame) {
+    if (frame.empty()) {
+        boost::asio::post(conn->socket.get_executor(), [conn, request_id]() { conn->cancel_hooks.erase(request_id); });
+        return;
+    }
+    // 响应帧携带请求的 request_id，哪个请求先完成就先写回；帧头写入预留空间，payload 不再复制
+    FrameBuffer::EncodeHeader(static_cast<uint32_t>(frame.size() - FrameBuffer::kHeaderSize), request_id, &frame[0]);
+    auto shared_frame = std::make_shared<std::string>(std::move(frame));
+    boost::asio::post(conn->socket.get_executor(), [this, conn, request_id, frame = std::move(shared_frame)]() {
+        conn->cancel_hooks.erase(request_id);
+        EnqueueFrame(conn, frame);
+    });
+}
+
+void AsioTransport::CancelServerCall(std::shared_ptr<Connection> conn, uint64_t request_id) {
+    auto it = conn->cancel_hooks.find(request_id);
+    if (it == conn->cancel_hooks.end()) {
+        return; // 已回复或未登记取消回调
+    }
+    CancelHook hook = std::move(it->second);
+    conn->cancel_hooks.erase(it);
+    XRPC_LOG_INFO("Request {} canceled by client", request_id);
+    hook();
+}
+
+void AsioTransport::CloseServerConnection(std::shared_ptr<Connection> conn) {
+    conn->closed = true;
+    boost::system::error_code ec;
+    conn->socket.close(ec);
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        if (server_connections_.erase(conn) > 0) {
+            io_pool_->AddLoad(conn->reactor_index, -1);
+        }
+    }
+    // 客户端已断开，回复无法送达，取消其上所有未完成的请求
+    std::unordered_map<uint64_t, CancelHook> hooks;
+    hooks.swap(conn->cancel_hooks);
+    for (auto& entry : hooks) {
+        entry.second();
     }
 }
 
-} // namespace xrpc
\ No newline at end of file
+} // namespace xrpc
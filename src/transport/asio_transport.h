@@ -1,58 +1,206 @@
 #ifndef ASIO_TRANSPORT_H
 #define ASIO_TRANSPORT_H
 
+#include "transport/frame_buffer.h"
+#include "transport/io_context_pool.h"
+#include "transport/timer_wheel.h"
 #include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <set>
 #include <thread>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace xrpc {
 
+// 连接：socket、接收缓冲区与发送队列，所有读写都在所属 reactor 线程执行
+struct Connection {
+    Connection(boost::asio::ip::tcp::socket s, size_t reactor) : socket(std::move(s)), reactor_index(reactor) {}
+    boost::asio::ip::tcp::socket socket;
+    size_t reactor_index; // 所属 reactor
+    FrameBuffer read_buffer;
+    std::deque<std::shared_ptr<std::string>> write_queue; // 待发送的完整帧
+    size_t write_queue_bytes = 0; // 排队及正在发送的字节数
+    bool writing = false;
+    bool read_paused = false; // 发送积压超过高水位时暂停读取
+    std::atomic<bool> closed{false};
+    std::atomic<int> inflight{0}; // 客户端连接上未完成的请求数
+    // 服务端连接上各请求的取消回调，只在所属 reactor 线程上访问
+    std::unordered_map<uint64_t, std::function<void()>> cancel_hooks;
+};
+
+// 单个服务端地址的客户端连接池
+struct EndpointPool {
+    EndpointPool(std::string i, int p) : ip(std::move(i)), port(p) {}
+    const std::string ip;
+    const int port;
+    std::mutex mutex; // 保护以下成员，建连期间不持有
+    std::condition_variable connected_cv; // 正在建连且没有可用连接时等待
+    std::vector<std::shared_ptr<Connection>> connections;
+    size_t connecting = 0; // 正在建立的连接数
+    // 建连失败后该地址视为不健康，retry_at 之前不再建连，退避时间每次失败翻倍
+    std::chrono::steady_clock::time_point retry_at;
+    std::chrono::milliseconds backoff{0};
+};
+
+// 客户端调用的结束状态
+enum class CallStatus {
+    OK,
+    FAILED,    // 连接失败或断开
+    TIMEOUT,   // 超时未收到响应，未完成请求已被移除
+    CANCELLED  // 被 CancelCall 取消，已通知服务端
+};
+
 class AsioTransport {
 public:
-    AsioTransport();
+    // 响应回调：(响应数据, 是否成功)
+    using ResponseCallback = std::function<void(const std::string&, bool)>;
+    // 带结束状态的响应回调
+    using CallCallback = std::function<void(const std::string& response, CallStatus status)>;
+    // 服务端请求回调：request 指向连接接收缓冲区，回调返回前一直有效
+    using ServerCallback = std::function<void(std::string_view request, std::string& response)>;
+    // 回复一个请求，可在任意线程调用且只调用一次；空字符串表示不回复
+    // 非空时前 FrameBuffer::kHeaderSize 字节为预留的帧头空间，其后为 payload，帧头在发送前原地写入
+    using Responder = std::function<void(std::string response)>;
+    // 异步请求回调：在连接所属 reactor 线程上直接调用，不应阻塞；request 持有接收缓冲块的引用
+    using AsyncServerCallback = std::function<void(FrameView request, Responder respond)>;
+    // 请求的取消回调：收到该请求的 CANCEL 帧或连接断开时在 reactor 线程上执行一次，请求回复后不再执行
+    using CancelHook = std::function<void()>;
+    // 同 AsyncServerCallback，返回的 CancelHook 非空时登记为该请求的取消回调
+    using CancellableServerCallback = std::function<CancelHook(FrameView request, Responder respond)>;
+
+    // io_threads 为 reactor 数量（0 表示 CPU 核数）
+    explicit AsioTransport(size_t io_threads = 1,
+                           IoContextPool::Balance balance = IoContextPool::Balance::ROUND_ROBIN);
     ~AsioTransport();
 
+    // 为 ip:port 建立连接池并设为默认地址，无法连接时抛出异常
     void Connect(const std::string& ip, int port);
-    void StartServer(const std::string& ip, int port, std::function<void(const std::string&, std::string&)> callback);
-    bool Send(const std::string& data, std::string& response);
-    void SendAsync(const std::string& data, std::function<void(const std::string&, bool)> callback);
+    // reuse_port 为 true 时每个 reactor 持有独立的 SO_REUSEPORT acceptor，由内核分发新连接
+    // 同步回调被分派到 reactor 池中执行
+    void StartServer(const std::string& ip, int port, ServerCallback callback, bool reuse_port = false);
+    void StartAsyncServer(const std::string& ip, int port, AsyncServerCallback callback, bool reuse_port = false);
+    void StartCancellableServer(const std::string& ip, int port, CancellableServerCallback callback,
+                                bool reuse_port = false);
+    // 同一连接上可同时存在多个请求，响应按 request_id 匹配，可乱序完成
+    bool Send(uint64_t request_id, const std::string& data, std::string& response);
+    void SendAsync(uint64_t request_id, const std::string& data, ResponseCallback callback);
+    // 发往指定地址，从该地址的连接池中取出负载最轻的连接
+    bool Send(const std::string& ip, int port, uint64_t request_id, const std::string& data, std::string& response);
+    void SendAsync(const std::string& ip, int port, uint64_t request_id, const std::string& data,
+                   ResponseCallback callback);
+    // frame 前 FrameBuffer::kHeaderSize 字节为预留的帧头空间，其后为 payload；frame 被直接移入发送队列，不做复制
+    // timeout 为 0 表示不限时，超时后以 CallStatus::TIMEOUT 结束调用
+    // 同步的 Send/SendFrame 不能在本 transport 的 reactor 线程（响应回调、Post 的任务）上调用，否则立即返回 FAILED
+    CallStatus SendFrame(const std::string& ip, int port, uint64_t request_id, std::string frame, std::string& response,
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    void SendFrameAsync(const std::string& ip, int port, uint64_t request_id, std::string frame,
+                        CallCallback callback, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    // 取得 ip:port 的连接池，不存在时创建；连接池在 transport 析构前一直有效，调用方可以缓存
+    EndpointPool* GetEndpointPool(const std::string& ip, int port);
+    // 发往已缓存的连接池，不再按地址查找
+    CallStatus SendFrame(EndpointPool* pool, uint64_t request_id, std::string frame, std::string& response,
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    void SendFrameAsync(EndpointPool* pool, uint64_t request_id, std::string frame, CallCallback callback,
+                        std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    // 调用仍未完成时移除并以 CallStatus::CANCELLED 结束，同时向服务端发送 CANCEL 帧；可在任意线程调用
+    void CancelCall(uint64_t request_id);
+    // 把任务轮询派发到 reactor 池中执行；有多个 reactor 时不选调用方所在的 reactor
+    void Post(std::function<void()> task);
     void Run();
     void Stop();
 
+    // 单个连接发送积压超过 bytes 时暂停读取该连接，降到一半以下再恢复；0 表示不限制
+    void SetWriteHighWaterMark(size_t bytes) { write_high_water_mark_ = bytes; }
+
+    static constexpr size_t kDefaultWriteHighWaterMark = 4 * 1024 * 1024;
+
+    // 每个地址至少保持 min_connections 个连接，负载升高时按需增长到 max_connections
+    void SetConnectionPoolSize(size_t min_connections, size_t max_connections);
+    // 当前 ip:port 连接池中的连接数
+    size_t PoolSize(const std::string& ip, int port);
+
+    // 最空闲的连接上未完成请求数达到该值时才新建连接
+    static constexpr int kPoolGrowThreshold = 32;
+
+    // 建连超时，以及建连失败后的重试退避区间
+    static constexpr std::chrono::milliseconds kConnectTimeout{3000};
+    static constexpr std::chrono::milliseconds kConnectRetryMin{100};
+    static constexpr std::chrono::milliseconds kConnectRetryMax{5000};
+
+    // 超时时间轮的精度与槽数，一圈约 5 秒，更长的超时多转几圈
+    static constexpr std::chrono::milliseconds kTimerWheelTick{10};
+    static constexpr size_t kTimerWheelSlots = 512;
+
 private:
-    void DoClientRead();
-    void HandleClientRead(const boost::system::error_code& ec, std::size_t bytes_transferred);
-    void DoClientAsyncRead(std::shared_ptr<std::array<char, 8192>> read_buffer,
-                          std::function<void(const std::string&, bool)> callback);
-    void HandleClientAsyncRead(std::shared_ptr<std::array<char, 8192>> read_buffer,
-                              std::function<void(const std::string&, bool)> callback,
-                              const boost::system::error_code& ec,
-                              std::size_t bytes_transferred);
-    void DoAccept();
-    void HandleAccept(std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::system::error_code& ec);
-    void DoServerRead(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
-    void HandleServerRead(std::shared_ptr<boost::asio::ip::tcp::socket> socket, 
-                         std::shared_ptr<std::array<char, 8192>> read_buffer,
-                         const boost::system::error_code& ec, 
+    // 从连接池取出健康且负载最轻的连接，必要时在锁外新建；失败或处于重试退避期返回 nullptr
+    std::shared_ptr<Connection> Checkout(EndpointPool* pool);
+    std::shared_ptr<Connection> Checkout(const std::string& ip, int port) { return Checkout(GetEndpointPool(ip, port)); }
+    // 同步建连，超过 kConnectTimeout 视为失败
+    std::shared_ptr<Connection> NewClientConnection(const std::string& ip, int port);
+    // 登记到未完成请求表并把帧放入连接的发送队列，timeout 非 0 时同时登记到连接所属 reactor 的时间轮
+    void StartCall(std::shared_ptr<Connection> conn, uint64_t request_id,
+                   std::string frame, CallCallback callback, std::chrono::milliseconds timeout);
+    // 时间轮到期：调用仍未完成时移除并以超时结束
+    void ExpireCall(uint64_t request_id);
+    // 调用提前结束：从连接所属 reactor 的时间轮删除其超时任务，可在任意线程调用
+    void RemoveTimer(const std::shared_ptr<Connection>& conn, uint64_t request_id, size_t timer_slot);
+    // 以下两个函数只能在连接所属 reactor 上调用
+    void EnqueueFrame(std::shared_ptr<Connection> conn, std::shared_ptr<std::string> frame);
+    void DoWrite(std::shared_ptr<Connection> conn);
+    void DoClientRead(std::shared_ptr<Connection> conn);
+    void HandleClientRead(std::shared_ptr<Connection> conn,
+                         const boost::system::error_code& ec,
+                         std::size_t bytes_transferred);
+    // 连接断开时以失败结束所有未完成的请求
+    void FailPendingCalls(std::shared_ptr<Connection> conn);
+    void DoAccept(size_t acceptor_index);
+    void HandleAccept(size_t acceptor_index, size_t reactor_index, const boost::system::error_code& ec,
+                      boost::asio::ip::tcp::socket socket);
+    void DoServerRead(std::shared_ptr<Connection> conn);
+    void HandleServerRead(std::shared_ptr<Connection> conn,
+                         const boost::system::error_code& ec,
                          std::size_t bytes_transferred);
+    // 在连接所属 reactor 上注销请求的取消回调，frame 非空时写入帧头后直接放入发送队列
+    void SendResponse(std::shared_ptr<Connection> conn, uint64_t request_id, std::string frame);
+    // 收到 CANCEL 帧：执行并移除该请求的取消回调，只能在连接所属 reactor 上调用
+    void CancelServerCall(std::shared_ptr<Connection> conn, uint64_t request_id);
+    void CloseServerConnection(std::shared_ptr<Connection> conn);
+
+    // 未完成的客户端请求
+    struct PendingCall {
+        std::shared_ptr<Connection> conn;
+        CallCallback callback;
+        size_t timer_slot = TimerWheel::kNoSlot; // 在连接所属 reactor 时间轮上的槽位
+    };
 
-    std::unique_ptr<boost::asio::io_context> io_context_;
-    std::unique_ptr<boost::asio::io_context::work> work_;
-    std::thread io_context_thread_;
-    std::shared_ptr<boost::asio::ip::tcp::socket> client_socket_; // 改为 shared_ptr
-    std::mutex socket_mutex_; // 保护 client_socket_
-    std::unique_ptr<boost::asio::ip::tcp::acceptor> server_acceptor_;
-    std::function<void(const std::string&, std::string&)> server_callback_;
-    std::string response_;
-    bool response_received_;
-    char read_buffer_[8192];
-    std::set<std::shared_ptr<boost::asio::ip::tcp::socket>> server_sockets_;
+    std::unique_ptr<IoContextPool> io_pool_;
+    std::atomic<size_t> next_task_{0}; // Post 的轮询位置，与连接分配相互独立
+    std::vector<std::unique_ptr<TimerWheel>> timer_wheels_; // 与 reactor 一一对应，先于 io_pool_ 析构
+    std::mutex pools_mutex_; // 保护 endpoint_pools_ 与默认地址
+    std::unordered_map<std::string, std::unique_ptr<EndpointPool>> endpoint_pools_; // key 为 ip:port
+    std::string default_ip_;
+    int default_port_;
+    std::atomic<size_t> pool_min_connections_; // Checkout 不加锁读取
+    std::atomic<size_t> pool_max_connections_;
+    std::mutex pending_mutex_;
+    std::unordered_map<uint64_t, PendingCall> pending_calls_;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> server_acceptors_;
+    bool reuse_port_;
+    size_t write_high_water_mark_;
+    CancellableServerCallback server_callback_;
+    std::mutex connections_mutex_; // 连接分布在多个 reactor 线程上
+    std::set<std::shared_ptr<Connection>> server_connections_;
 };
 
 } // namespace xrpc
 
-#endif // ASIO_TRANSPORT_H
\ No newline at end of file
+#endif // ASIO_TRANSPORT_H
@@ -0,0 +1,125 @@
+#include "transport/frame_buffer.h"
+#include "core/common/xrpc_logger.h"
+#include <cstring>
+
+namespace xrpc {
+
+FrameBuffer::FrameBuffer()
+    : buffer_(std::make_shared<std::vector<char>>(kInitialSize)), read_pos_(0), write_pos_(0), error_(false) {}
+
+void FrameBuffer::EncodeHeader(uint32_t length, uint64_t request_id, char* out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((length >> (24 - 8 * i)) & 0xFF);
+    }
+    for (int i = 0; i < 8; ++i) {
+        out[4 + i] = static_cast<char>((request_id >> (56 - 8 * i)) & 0xFF);
+    }
+}
+
+std::string FrameBuffer::Pack(const std::string& payload, uint64_t request_id) {
+    std::string frame(kHeaderSize + payload.size(), '\0');
+    EncodeHeader(static_cast<uint32_t>(payload.size()), request_id, &frame[0]);
+    std::memcpy(&frame[kHeaderSize], payload.data(), payload.size());
+    return frame;
+}
+
+std::string FrameBuffer::PackCancel(uint64_t request_id) {
+    std::string frame(kHeaderSize, '\0');
+    EncodeHeader(0, request_id, &frame[0]);
+    return frame;
+}
+
+char* FrameBuffer::PrepareWrite(size_t min_size) {
+    // 没有帧视图引用当前块时才能原地回收空间
+    bool exclusive = buffer_.use_count() == 1;
+    if (exclusive && read_pos_ == write_pos_) {
+        read_pos_ = 0;
+        write_pos_ = 0;
+    }
+    if (WritableBytes() >= min_size) {
+        return buffer_->data() + write_pos_;
+    }
+    size_t readable = ReadableBytes();
+    if (!exclusive) {
+        // 已交出的帧仍在使用旧块，只把未消费的数据搬到新块
+        size_t new_size = kInitialSize;
+        while (new_size < readable + min_size) {
+            new_size *= 2;
+        }
+        auto block = std::make_shared<std::vector<char>>(new_size);
+        std::memcpy(block->data(), buffer_->data() + read_pos_, readable);
+        buffer_ = std::move(block);
+        read_pos_ = 0;
+        write_pos_ = readable;
+        return buffer_->data() + write_pos_;
+    }
+    // 先回收已消费的空间，仍不足时再扩容
+    if (read_pos_ > 0) {
+        std::memmove(buffer_->data(), buffer_->data() + read_pos_, readable);
+        read_pos_ = 0;
+        write_pos_ = readable;
+    }
+    if (WritableBytes() < min_size) {
+        size_t new_size = buffer_->size();
+        while (new_size - write_pos_ < min_size) {
+            new_size *= 2;
+        }
+        buffer_->resize(new_size);
+    }
+    return buffer_->data() + write_pos_;
+}
+
+void FrameBuffer::CommitWrite(size_t bytes) {
+    write_pos_ += bytes;
+}
+
+bool FrameBuffer::NextFrame(std::string* frame, uint64_t* request_id) {
+    FrameView view;
+    if (!NextFrame(&view, request_id)) {
+        return false;
+    }
+    frame->assign(view.data, view.size);
+    return true;
+}
+
+bool FrameBuffer::NextFrame(FrameView* frame, uint64_t* request_id) {
+    if (error_ || ReadableBytes() < kHeaderSize) {
+        return false;
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buffer_->data() + read_pos_);
+    uint32_t length = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                      (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    if (length > kMaxFrameSize) {
+        XRPC_LOG_ERROR("Frame length {} exceeds limit {}", length, kMaxFrameSize);
+        error_ = true;
+        return false;
+    }
+    if (ReadableBytes() < kHeaderSize + length) {
+        // 提前为剩余数据预留空间，避免大包多次扩容
+        PrepareWrite(kHeaderSize + length - ReadableBytes());
+        return false;
+    }
+    if (request_id) {
+        uint64_t id = 0;
+        for (int i = 4; i < 12; ++i) {
+            id = (id << 8) | p[i];
+        }
+        *request_id = id;
+    }
+    frame->block = buffer_;
+    frame->data = buffer_->data() + read_pos_ + kHeaderSize;
+    frame->size = length;
+    read_pos_ += kHeaderSize + length;
+    return true;
+}
+
+void FrameBuffer::Clear() {
+    if (buffer_.use_count() > 1) {
+        buffer_ = std::make_shared<std::vector<char>>(kInitialSize);
+    }
+    read_pos_ = 0;
+    write_pos_ = 0;
+    error_ = false;
+}
+
+} // namespace xrpc
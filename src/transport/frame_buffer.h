@@ -0,0 +1,73 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xrpc {
+/***
+传输层帧格式
++----------------------+--------------------------+------------------+
+| uint32 (大端) 长度    | uint64 (大端) request_id  | payload 数据      |
++----------------------+--------------------------+------------------+
+长度只计 payload；payload 为 XrpcCodec 编码后的完整消息
+request_id 用于在同一连接上匹配多路复用的请求与响应
+payload 为空的帧是 CANCEL 控制帧：客户端通知服务端放弃该 request_id 的请求（正常请求和响应的 payload 都不为空）
+***/
+
+// 接收缓冲区中一个完整帧的视图，持有所在缓冲块的引用，视图释放前这段数据不会被覆盖
+struct FrameView {
+    std::shared_ptr<const std::vector<char>> block;
+    const char* data = nullptr;
+    size_t size = 0;
+
+    std::string_view View() const { return std::string_view(data, size); }
+};
+
+// 每个连接独立的可增长接收缓冲区，支持增量解析
+class FrameBuffer {
+public:
+    static constexpr size_t kHeaderSize = 12;
+    static constexpr size_t kMaxFrameSize = 64 * 1024 * 1024; // 单帧上限，防止异常长度撑爆内存
+    static constexpr size_t kInitialSize = 8192;
+
+    FrameBuffer();
+
+    // 为 payload 添加帧头
+    static std::string Pack(const std::string& payload, uint64_t request_id = 0);
+    // 取消 request_id 对应请求的控制帧
+    static std::string PackCancel(uint64_t request_id);
+    // 写入 kHeaderSize 字节的帧头
+    static void EncodeHeader(uint32_t length, uint64_t request_id, char* out);
+
+    // 确保至少有 min_size 字节可写空间，返回可写区域
+    char* PrepareWrite(size_t min_size = 4096);
+    size_t WritableBytes() const { return buffer_->size() - write_pos_; }
+    // 提交 socket 实际读入的字节数
+    void CommitWrite(size_t bytes);
+
+    // 取出下一个完整帧，数据不足时返回 false
+    bool NextFrame(std::string* frame, uint64_t* request_id = nullptr);
+    // 同上，但不复制 payload，返回指向缓冲区的视图
+    bool NextFrame(FrameView* frame, uint64_t* request_id = nullptr);
+
+    // 帧长度非法（超过上限），连接应被关闭
+    bool HasError() const { return error_; }
+    size_t ReadableBytes() const { return write_pos_ - read_pos_; }
+    void Clear();
+
+private:
+    // 仍有 FrameView 引用时缓冲块不再原地移动或复用，新数据写入新块
+    std::shared_ptr<std::vector<char>> buffer_;
+    size_t read_pos_;
+    size_t write_pos_;
+    bool error_;
+};
+
+} // namespace xrpc
+
+#endif // FRAME_BUFFER_H
@@ -0,0 +1,85 @@
+#include "transport/io_context_pool.h"
+#include "core/common/xrpc_logger.h"
+#include <algorithm>
+
+namespace xrpc {
+
+IoContextPool::IoContextPool(size_t size, Balance balance) : balance_(balance), next_(0) {
+    if (size == 0) {
+        size = std::max(1u, std::thread::hardware_concurrency());
+    }
+    loads_.reset(new std::atomic<int>[size]);
+    for (size_t i = 0; i < size; ++i) {
+        loads_[i] = 0;
+        io_contexts_.emplace_back(new boost::asio::io_context);
+        works_.emplace_back(new boost::asio::io_context::work(*io_contexts_.back()));
+    }
+    for (size_t i = 0; i < size; ++i) {
+        boost::asio::io_context* io_context = io_contexts_[i].get();
+        threads_.emplace_back([io_context]() { io_context->run(); });
+    }
+    XRPC_LOG_DEBUG("IoContextPool started with {} reactors", size);
+}
+
+IoContextPool::~IoContextPool() {
+    Stop();
+}
+
+size_t IoContextPool::Next() {
+    if (balance_ == Balance::LEAST_LOAD) {
+        size_t best = 0;
+        for (size_t i = 1; i < io_contexts_.size(); ++i) {
+            if (loads_[i].load(std::memory_order_relaxed) < loads_[best].load(std::memory_order_relaxed)) {
+                best = i;
+            }
+        }
+        return best;
+    }
+    return next_.fetch_add(1, std::memory_order_relaxed) % io_contexts_.size();
+}
+
+bool IoContextPool::RunningInThisThread() const {
+    for (const auto& io_context : io_contexts_) {
+        if (io_context->get_executor().running_in_this_thread()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IoContextPool::AddLoad(size_t index, int delta) {
+    loads_[index].fetch_add(delta, std::memory_order_relaxed);
+}
+
+int IoContextPool::Load(size_t index) const {
+    return loads_[index].load(std::memory_order_relaxed);
+}
+
+void IoContextPool::Stop() {
+    works_.clear();
+    for (auto& io_context : io_contexts_) {
+        io_context->stop();
+    }
+    for (auto& thread : threads_) {
+        if (!thread.joinable()) {
+            continue;
+        }
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach(); // 在 reactor 线程内析构时无法 join 自身
+        } else {
+            thread.join();
+        }
+    }
+}
+
+IoContextPool::Balance IoContextPool::ParseBalance(const std::string& name) {
+    if (name == "least_load") {
+        return Balance::LEAST_LOAD;
+    }
+    if (name != "round_robin") {
+        XRPC_LOG_WARN("Unknown io_balance {}, fallback to round_robin", name);
+    }
+    return Balance::ROUND_ROBIN;
+}
+
+} // namespace xrpc
@@ -0,0 +1,60 @@
+#ifndef IO_CONTEXT_POOL_H
+#define IO_CONTEXT_POOL_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xrpc {
+
+// 多 reactor 线程池：每个 io_context 由独立线程驱动
+class IoContextPool {
+public:
+    // 连接分配策略
+    enum class Balance {
+        ROUND_ROBIN, // 轮询
+        LEAST_LOAD   // 选择当前连接数最少的 reactor
+    };
+
+    // size 为 0 时使用 CPU 核数
+    explicit IoContextPool(size_t size, Balance balance = Balance::ROUND_ROBIN);
+    ~IoContextPool();
+
+    IoContextPool(const IoContextPool&) = delete;
+    IoContextPool& operator=(const IoContextPool&) = delete;
+
+    size_t Size() const { return io_contexts_.size(); }
+    boost::asio::io_context& GetIoContext(size_t index) { return *io_contexts_[index]; }
+
+    // 按策略选择一个 reactor，返回其下标
+    size_t Next();
+
+    // 当前线程是否是本池的某个 reactor 线程
+    bool RunningInThisThread() const;
+
+    // 维护每个 reactor 上的连接数，供 LEAST_LOAD 使用
+    void AddLoad(size_t index, int delta);
+    int Load(size_t index) const;
+
+    // 停止所有 io_context 并等待线程退出
+    void Stop();
+
+    // 解析配置中的策略名（round_robin / least_load）
+    static Balance ParseBalance(const std::string& name);
+
+private:
+    Balance balance_;
+    std::vector<std::unique_ptr<boost::asio::io_context>> io_contexts_;
+    std::vector<std::unique_ptr<boost::asio::io_context::work>> works_;
+    std::vector<std::thread> threads_;
+    std::unique_ptr<std::atomic<int>[]> loads_;
+    std::atomic<size_t> next_;
+};
+
+} // namespace xrpc
+
+#endif // IO_CONTEXT_POOL_H
@@ -0,0 +1,88 @@
+#include "transport/timer_wheel.h"
+#include <algorithm>
+
+namespace xrpc {
+
+TimerWheel::TimerWheel(boost::asio::io_context& io_context, std::chrono::milliseconds tick, size_t slots,
+                       ExpireCallback on_expire)
+    : timer_(io_context), tick_(std::max(tick, std::chrono::milliseconds(1))),
+      slots_(std::max<size_t>(1, slots)), on_expire_(std::move(on_expire)),
+      cursor_(0), count_(0), armed_(false) {
+}
+
+size_t TimerWheel::Add(uint64_t id, std::chrono::milliseconds timeout) {
+    // 当前 tick 已过去一部分，多算一个 tick，保证不早于 timeout 到期
+    size_t ticks = static_cast<size_t>((timeout.count() + tick_.count() - 1) / tick_.count()) + 1;
+    size_t slot = (cursor_ + ticks) % slots_.size();
+    slots_[slot].push_back(Entry{id, (ticks - 1) / slots_.size()});
+    ++count_;
+    if (!armed_) {
+        next_tick_ = std::chrono::steady_clock::now() + tick_;
+        Arm();
+    }
+    return slot;
+}
+
+void TimerWheel::Remove(uint64_t id, size_t slot) {
+    if (slot >= slots_.size()) {
+        return;
+    }
+    // 槽数远大于同时在途的请求数时，每个槽只有少量任务
+    auto& entries = slots_[slot];
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].id == id) {
+            entries[i] = entries.back();
+            entries.pop_back();
+            --count_;
+            return;
+        }
+    }
+}
+
+void TimerWheel::Stop() {
+    boost::system::error_code ec;
+    timer_.cancel(ec);
+    armed_ = false;
+}
+
+void TimerWheel::Arm() {
+    armed_ = true;
+    timer_.expires_at(next_tick_);
+    timer_.async_wait([this](const boost::system::error_code& ec) { OnTick(ec); });
+}
+
+void TimerWheel::OnTick(const boost::system::error_code& ec) {
+    if (ec) {
+        armed_ = false;
+        return;
+    }
+    // reactor 繁忙导致定时器迟到时，补齐错过的 tick
+    auto now = std::chrono::steady_clock::now();
+    std::vector<uint64_t> expired;
+    while (next_tick_ <= now) {
+        cursor_ = (cursor_ + 1) % slots_.size();
+        next_tick_ += tick_;
+        auto& slot = slots_[cursor_];
+        for (size_t i = 0; i < slot.size();) {
+            if (slot[i].rounds == 0) {
+                expired.push_back(slot[i].id);
+                slot[i] = slot.back();
+                slot.pop_back();
+            } else {
+                --slot[i].rounds;
+                ++i;
+            }
+        }
+    }
+    count_ -= expired.size();
+    // 回调可能再次调用 Add，先更新计数和定时器状态
+    armed_ = false;
+    if (count_ > 0) {
+        Arm();
+    }
+    for (uint64_t id : expired) {
+        on_expire_(id);
+    }
+}
+
+} // namespace xrpc
@@ -0,0 +1,58 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace xrpc {
+
+// 哈希时间轮：每个 reactor 一个，所有操作都在所属 reactor 线程上执行，不加锁
+// 只有一个 steady_timer 按 tick 推进，轮上没有任务时不再唤醒；提前完成的任务按 Add 返回的槽位删除
+class TimerWheel {
+public:
+    using ExpireCallback = std::function<void(uint64_t id)>;
+
+    TimerWheel(boost::asio::io_context& io_context, std::chrono::milliseconds tick, size_t slots,
+               ExpireCallback on_expire);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // timeout 向上取整到 tick 后再加一个 tick，不会早于 timeout 到期，最多晚两个 tick；返回任务所在的槽位，供 Remove 使用
+    size_t Add(uint64_t id, std::chrono::milliseconds timeout);
+    // 删除尚未到期的任务，已到期或不存在时忽略；轮空后定时器在下一个 tick 停止
+    void Remove(uint64_t id, size_t slot);
+
+    size_t Size() const { return count_; }
+
+    void Stop();
+
+    // 表示未登记到时间轮的槽位
+    static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+private:
+    struct Entry {
+        uint64_t id;
+        size_t rounds; // 还需转过的整圈数
+    };
+
+    void Arm();
+    void OnTick(const boost::system::error_code& ec);
+
+    boost::asio::steady_timer timer_;
+    std::chrono::milliseconds tick_;
+    std::vector<std::vector<Entry>> slots_;
+    ExpireCallback on_expire_;
+    size_t cursor_;
+    size_t count_;
+    bool armed_;
+    std::chrono::steady_clock::time_point next_tick_;
+};
+
+} // namespace xrpc
+
+#endif // TIMER_WHEEL_H
@@ -54,7 +54,7 @@ protected:
         bool registered = false;
         while (retries-- > 0) {
             auto instances = zk.FindInstancesByMethod("UserService", "Login");
-            if (!instances.empty()) {
+            if (!instances->empty()) {
                 registered = true;
                 break;
             }
@@ -5,6 +5,7 @@
 #include "user_service.pb.h"
 #include "core/common/xrpc_logger.h"
 #include <google/protobuf/stubs/callback.h>
+#include <atomic>
 #include <thread>
 #include <chrono>
 #include <condition_variable>
@@ -13,23 +14,64 @@
 
 namespace xrpc {
 
+// 模拟长时间处理，最多 500ms；收到取消通知时提前结束，并记录服务端控制器是否收到取消
 class SlowMockUserService : public example::UserService {
 public:
     void Login(google::protobuf::RpcController* controller,
                const example::LoginRequest* request,
                example::LoginResponse* response,
                google::protobuf::Closure* done) override {
-        // 模拟长时间处理
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        if (dynamic_cast<XrpcController*>(controller)->IsCanceled()) {
+        controller->NotifyOnCancel(google::protobuf::NewCallback(this, &SlowMockUserService::OnCancel));
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            started_ = true;
+            cv_.notify_all();
+            cv_.wait_for(lock, std::chrono::milliseconds(500), [this] { return notified_; });
+        }
+        observed_cancel = controller->IsCanceled();
+        if (observed_cancel) {
             controller->SetFailed("Request canceled");
-            if (done) done->Run();
-            return;
+        } else {
+            response->set_success(true);
+            response->set_token("mock_token");
         }
-        response->set_success(true);
-        response->set_token("mock_token");
         if (done) done->Run();
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        cv_.notify_all();
+    }
+
+    void OnCancel() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        notified_ = true;
+        cv_.notify_all();
+    }
+
+    // 等待处理函数开始执行
+    bool WaitStarted() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(5), [this] { return started_; });
+    }
+
+    // 等待处理函数执行完 done
+    bool WaitFinished() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(5), [this] { return finished_; });
+    }
+
+    bool Notified() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return notified_;
     }
+
+    std::atomic<bool> observed_cancel{false};
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool started_ = false;
+    bool notified_ = false;
+    bool finished_ = false;
 };
 
 class CancelTest : public ::testing::Test {
@@ -62,7 +104,7 @@ protected:
         bool registered = false;
         while (retries-- > 0) {
             auto instances = zk.FindInstancesByMethod("UserService", "Login");
-            if (!instances.empty()) {
+            if (!instances->empty()) {
                 registered = true;
                 break;
             }
@@ -173,4 +215,32 @@ TEST_F(CancelTest, NotifyOnCancel) {
     EXPECT_TRUE(cancel_callback_called_);
 }
 
-} // namespace xrpc
\ No newline at end of file
+TEST_F(CancelTest, CancelReachesServerHandler) {
+    XrpcChannel channel(config_file_);
+    example::UserService_Stub stub(&channel);
+    XrpcController controller;
+    example::LoginRequest request;
+    example::LoginResponse response;
+    std::atomic<bool> client_done{false};
+    stub.Login(&controller, &request, &response,
+               google::protobuf::NewCallback(+[](std::atomic<bool>* flag) { *flag = true; }, &client_done));
+    ASSERT_TRUE(mock_service_.WaitStarted());
+    controller.StartCancel();
+
+    // 客户端立即以取消结束，不等待服务端
+    EXPECT_TRUE(client_done.load());
+    EXPECT_TRUE(controller.Failed());
+    EXPECT_EQ(controller.GetErrorCode(), ErrorCode::CANCELLED);
+    EXPECT_EQ(controller.ErrorText(), "Request was canceled");
+
+    // CANCEL 帧让服务端控制器进入取消状态，处理函数被 NotifyOnCancel 唤醒而不是等满 500ms
+    ASSERT_TRUE(mock_service_.WaitFinished());
+    EXPECT_TRUE(mock_service_.Notified());
+    EXPECT_TRUE(mock_service_.observed_cancel.load());
+
+    const MethodStats* stats = server_->GetMethodStats("UserService", "Login");
+    ASSERT_NE(stats, nullptr);
+    EXPECT_EQ(stats->cancelled.load(), 1u);
+}
+
+} // namespace xrpc
@@ -6,6 +6,7 @@
 #include "core/common/xrpc_logger.h"
 #include <thread>
 #include <chrono>
+#include <vector>
 #include "registry/zookeeper_client.h"
 
 namespace xrpc {
@@ -43,7 +44,7 @@ protected:
         bool registered = false;
         while (retries-- > 0) {
             auto instances = zk.FindInstancesByMethod("UserService", "Login");
-            if (!instances.empty()) {
+            if (!instances->empty()) {
                 registered = true;
                 break;
             }
@@ -128,4 +129,28 @@ TEST_F(ChannelTest, LoginFailure) {
     channel.reset();
 }
 
+TEST_F(ChannelTest, CallAsyncFanOut) {
+    std::unique_ptr<XrpcChannel> channel = std::make_unique<XrpcChannel>(config_file_);
+    const google::protobuf::MethodDescriptor* method = example::UserService::descriptor()->FindMethodByName("Login");
+
+    std::vector<XrpcFuture<example::LoginResponse>> futures;
+    for (int i = 0; i < 4; ++i) {
+        example::LoginRequest request;
+        request.set_username(i == 3 ? "wrong_user" : "test_user");
+        request.set_password("test_pass");
+        futures.push_back(channel->CallAsync<example::LoginResponse>(method, request));
+    }
+
+    auto all = WhenAll(futures);
+    ASSERT_NE(all.Get(std::chrono::seconds(2)), nullptr) << "Fan-out calls not completed";
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(futures[i].Failed()) << futures[i].ErrorText();
+        EXPECT_EQ(futures[i].Get().token(), "mock_token");
+    }
+    EXPECT_TRUE(futures[3].Failed());
+    EXPECT_EQ(futures[3].ErrorText(), "Invalid credentials");
+
+    channel.reset();
+}
+
 } // namespace xrpc
\ No newline at end of file
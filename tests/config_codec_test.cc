@@ -196,4 +196,57 @@ TEST(XrpcCodecTest, EncodeAndDecodeResponseWithCompressionLargeData) {
     EXPECT_EQ(decoded_header.status(), 0);
     EXPECT_TRUE(decoded_header.compressed()); // 大数据应压缩
     EXPECT_EQ(decoded_response.value(), std::string(1000, 'a'));
-}
\ No newline at end of file
+}
+
+TEST(XrpcCodecTest, EncodeWithHeadroom) {
+    xrpc::XrpcCodec codec;
+    xrpc::RpcHeader header;
+    header.set_service_name("UserService");
+    header.set_method_name("Login");
+    header.set_request_id(12345);
+
+    google::protobuf::StringValue args;
+    args.set_value(std::string(4096, 'h'));
+
+    // 预留的空间之后与不预留时的编码结果完全一致
+    const size_t kHeadroom = 12;
+    std::string plain = codec.Encode(header, args);
+    std::string framed = codec.Encode(header, args, kHeadroom);
+    ASSERT_EQ(framed.size(), plain.size() + kHeadroom);
+    EXPECT_EQ(framed.substr(kHeadroom), plain);
+
+    xrpc::RpcHeader decoded_header;
+    std::string decoded_args;
+    ASSERT_TRUE(codec.Decode(framed.substr(kHeadroom), decoded_header, decoded_args));
+    google::protobuf::StringValue decoded_message;
+    ASSERT_TRUE(decoded_message.ParseFromString(decoded_args));
+    EXPECT_EQ(decoded_message.value(), args.value());
+}
+
+TEST(XrpcCodecTest, DecodeHeaderWithoutCopy) {
+    xrpc::XrpcCodec codec;
+    xrpc::RpcHeader header;
+    header.set_service_name("UserService");
+    header.set_method_name("Login");
+    header.set_compressed(true);
+
+    google::protobuf::StringValue args;
+    args.set_value(std::string(1000, 'c'));
+    std::string encoded = codec.Encode(header, args);
+
+    // body 指向 encoded 内部，压缩数据在 ParseBody 中解压
+    xrpc::RpcHeader decoded_header;
+    const char* body = nullptr;
+    size_t body_size = 0;
+    ASSERT_TRUE(codec.DecodeHeader(encoded.data(), encoded.size(), decoded_header, &body, &body_size));
+    EXPECT_TRUE(decoded_header.compressed());
+    EXPECT_GE(body, encoded.data());
+    EXPECT_EQ(body + body_size, encoded.data() + encoded.size());
+
+    google::protobuf::StringValue decoded_message;
+    ASSERT_TRUE(codec.ParseBody(decoded_header, body, body_size, decoded_message));
+    EXPECT_EQ(decoded_message.value(), args.value());
+
+    // 截断的输入不能越界读取
+    EXPECT_FALSE(codec.DecodeHeader(encoded.data(), encoded.size() - 1, decoded_header, &body, &body_size));
+}
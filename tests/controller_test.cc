@@ -36,4 +36,45 @@ TEST_F(ControllerTest, Cancel) {
     EXPECT_TRUE(controller_->IsCanceled());
 }
 
-} // namespace xrpc
\ No newline at end of file
+// 取消回调在锁外执行，回调内可以再访问同一个控制器
+static void OnCancel(XrpcController* controller, bool* seen) {
+    *seen = controller->IsCanceled();
+    controller->SetFailed(ErrorCode::CANCELLED, "canceled");
+}
+
+TEST_F(ControllerTest, CancelCallbackMayUseController) {
+    bool seen = false;
+    controller_->NotifyOnCancel(google::protobuf::NewCallback(&OnCancel, controller_.get(), &seen));
+    controller_->StartCancel();
+    EXPECT_TRUE(seen);
+    EXPECT_EQ(controller_->GetErrorCode(), ErrorCode::CANCELLED);
+
+    // 已取消后登记的回调立即执行
+    seen = false;
+    controller_->NotifyOnCancel(google::protobuf::NewCallback(&OnCancel, controller_.get(), &seen));
+    EXPECT_TRUE(seen);
+}
+
+TEST_F(ControllerTest, TimeoutAndErrorCode) {
+    EXPECT_EQ(controller_->Timeout(), 0);
+    EXPECT_EQ(controller_->GetErrorCode(), ErrorCode::OK);
+    controller_->SetTimeout(200);
+    EXPECT_EQ(controller_->Timeout(), 200);
+    controller_->SetFailed(ErrorCode::TIMEOUT, "Request timed out");
+    EXPECT_EQ(controller_->GetErrorCode(), ErrorCode::TIMEOUT);
+    controller_->Reset();
+    EXPECT_EQ(controller_->Timeout(), 0);
+    EXPECT_EQ(controller_->GetErrorCode(), ErrorCode::OK);
+}
+
+TEST_F(ControllerTest, Deadline) {
+    EXPECT_FALSE(controller_->HasDeadline());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    controller_->SetDeadline(deadline);
+    EXPECT_TRUE(controller_->HasDeadline());
+    EXPECT_EQ(controller_->Deadline(), deadline);
+    controller_->Reset();
+    EXPECT_FALSE(controller_->HasDeadline());
+}
+
+} // namespace xrpc
@@ -0,0 +1,142 @@
+#include "core/coro/xrpc_coro.h"
+
+#ifdef XRPC_HAS_COROUTINES
+
+#include <gtest/gtest.h>
+#include "core/controller/xrpc_controller.h"
+#include "user_service.pb.h"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace xrpc {
+
+// 不经过网络的 channel：同步或在另一个线程上完成调用
+class FakeChannel : public google::protobuf::RpcChannel {
+public:
+    explicit FakeChannel(bool complete_async) : complete_async_(complete_async) {}
+    ~FakeChannel() override {
+        for (auto& t : threads_) {
+            t.join();
+        }
+    }
+
+    void CallMethod(const google::protobuf::MethodDescriptor* method,
+                    google::protobuf::RpcController* controller,
+                    const google::protobuf::Message* request,
+                    google::protobuf::Message* response,
+                    google::protobuf::Closure* done) override {
+        auto complete = [controller, request, response, done]() {
+            auto* login_request = static_cast<const example::LoginRequest*>(request);
+            auto* login_response = static_cast<example::LoginResponse*>(response);
+            if (login_request->password() == "test_pass") {
+                login_response->set_success(true);
+                login_response->set_token("token_" + login_request->username());
+            } else {
+                controller->SetFailed("Invalid credentials");
+            }
+            done->Run();
+        };
+        if (complete_async_) {
+            threads_.emplace_back(complete);
+        } else {
+            complete();
+        }
+    }
+
+private:
+    bool complete_async_;
+    std::vector<std::thread> threads_;
+};
+
+Task<example::LoginResponse> Login(example::UserService_Stub* stub, XrpcController* controller,
+                                   const std::string& username, const std::string& password) {
+    example::LoginRequest request;
+    request.set_username(username);
+    request.set_password(password);
+    co_return co_await CoCall(stub, &example::UserService_Stub::Login, controller, request);
+}
+
+TEST(CoroTest, CallCompletingInline) {
+    FakeChannel channel(false);
+    example::UserService_Stub stub(&channel);
+    XrpcController controller;
+    example::LoginResponse response = SyncWait(Login(&stub, &controller, "test_user", "test_pass"));
+    EXPECT_FALSE(controller.Failed());
+    EXPECT_EQ(response.token(), "token_test_user");
+}
+
+TEST(CoroTest, CallResumesOnCompletionThread) {
+    FakeChannel channel(true);
+    example::UserService_Stub stub(&channel);
+    XrpcController ok_controller;
+    XrpcController failed_controller;
+    auto both = [&]() -> Task<int> {
+        example::LoginResponse first = co_await Login(&stub, &ok_controller, "a", "test_pass");
+        example::LoginResponse second = co_await Login(&stub, &failed_controller, "b", "wrong");
+        co_return static_cast<int>(first.success()) + static_cast<int>(second.success());
+    };
+    EXPECT_EQ(SyncWait(both()), 1);
+    EXPECT_FALSE(ok_controller.Failed());
+    EXPECT_TRUE(failed_controller.Failed());
+    EXPECT_EQ(failed_controller.ErrorText(), "Invalid credentials");
+}
+
+class CoroUserService : public example::UserService {
+public:
+    void Login(google::protobuf::RpcController* controller,
+               const example::LoginRequest* request,
+               example::LoginResponse* response,
+               google::protobuf::Closure* done) override {
+        Spawn(DoLogin(request, response), controller, done);
+    }
+
+private:
+    Task<void> DoLogin(const example::LoginRequest* request, example::LoginResponse* response) {
+        if (request->username().empty()) {
+            throw std::runtime_error("Empty username");
+        }
+        response->set_success(true);
+        co_return;
+    }
+};
+
+void SetFlag(bool* flag) {
+    *flag = true;
+}
+
+TEST(CoroTest, SpawnedHandlerRunsDone) {
+    CoroUserService service;
+    bool done_called = false;
+
+    XrpcController controller;
+    example::LoginRequest request;
+    request.set_username("test_user");
+    example::LoginResponse response;
+    service.Login(&controller, &request, &response, google::protobuf::NewCallback(&SetFlag, &done_called));
+    EXPECT_TRUE(done_called);
+    EXPECT_TRUE(response.success());
+    EXPECT_FALSE(controller.Failed());
+
+    done_called = false;
+    XrpcController failed_controller;
+    request.clear_username();
+    example::LoginResponse failed_response;
+    service.Login(&failed_controller, &request, &failed_response,
+                  google::protobuf::NewCallback(&SetFlag, &done_called));
+    EXPECT_TRUE(done_called);
+    EXPECT_TRUE(failed_controller.Failed());
+    EXPECT_EQ(failed_controller.ErrorText(), "Empty username");
+}
+
+TEST(CoroTest, FramePoolReusesBlocks) {
+    void* first = FramePool::Allocate(200);
+    FramePool::Deallocate(first, 200);
+    void* second = FramePool::Allocate(230); // 同一分级
+    EXPECT_EQ(first, second);
+    FramePool::Deallocate(second, 230);
+}
+
+} // namespace xrpc
+
+#endif // XRPC_HAS_COROUTINES
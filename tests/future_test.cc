@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "core/channel/xrpc_future.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xrpc {
+
+TEST(FutureTest, GetWaitsForValue) {
+    XrpcPromise<int> promise;
+    XrpcFuture<int> future = promise.GetFuture();
+    EXPECT_FALSE(future.Ready());
+    EXPECT_EQ(future.Get(std::chrono::milliseconds(10)), nullptr);
+
+    std::thread producer([&promise]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        promise.SetValue(42);
+    });
+    EXPECT_EQ(future.Get(), 42);
+    EXPECT_FALSE(future.Failed());
+    producer.join();
+}
+
+TEST(FutureTest, ThenRunsOnCompletingThread) {
+    XrpcPromise<std::string> promise;
+    std::thread::id callback_thread;
+    XrpcFuture<size_t> length = promise.GetFuture().Then([&callback_thread](const XrpcFuture<std::string>& f) {
+        callback_thread = std::this_thread::get_id();
+        return f.Get().size();
+    });
+
+    std::thread producer([&promise]() { promise.SetValue("hello"); });
+    std::thread::id producer_thread = producer.get_id();
+    producer.join();
+    EXPECT_EQ(length.Get(), 5u);
+    EXPECT_EQ(callback_thread, producer_thread);
+
+    // 已完成的 future 上注册的回调立即执行
+    bool called = false;
+    promise.GetFuture().Then([&called](const XrpcFuture<std::string>&) { called = true; });
+    EXPECT_TRUE(called);
+}
+
+TEST(FutureTest, FailurePropagates) {
+    XrpcPromise<int> promise;
+    promise.SetFailed("backend down");
+    promise.SetValue(1); // 结果只设置一次
+    XrpcFuture<int> future = promise.GetFuture();
+    ASSERT_TRUE(future.Ready());
+    EXPECT_TRUE(future.Failed());
+    EXPECT_EQ(future.ErrorText(), "backend down");
+}
+
+TEST(FutureTest, WhenAllAndWhenAny) {
+    std::vector<XrpcPromise<int>> promises(3);
+    std::vector<XrpcFuture<int>> futures;
+    for (auto& promise : promises) {
+        futures.push_back(promise.GetFuture());
+    }
+    auto all = WhenAll(futures);
+    auto any = WhenAny(futures);
+
+    promises[1].SetValue(10);
+    ASSERT_TRUE(any.Ready());
+    EXPECT_EQ(any.Get(), 1u);
+    EXPECT_FALSE(all.Ready());
+
+    promises[0].SetValue(20);
+    promises[2].SetFailed("timeout");
+    ASSERT_TRUE(all.Ready());
+    const auto& results = all.Get();
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].Get(), 20);
+    EXPECT_EQ(results[1].Get(), 10);
+    EXPECT_TRUE(results[2].Failed());
+
+    EXPECT_TRUE(WhenAll(std::vector<XrpcFuture<int>>()).Ready());
+    EXPECT_TRUE(WhenAny(std::vector<XrpcFuture<int>>()).Failed());
+}
+
+} // namespace xrpc
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "core/channel/load_balancer.h"
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace xrpc {
+
+static EndpointList MakeEndpoints(const std::vector<std::pair<std::string, uint32_t>>& instances) {
+    EndpointList endpoints;
+    for (const auto& [address, weight] : instances) {
+        auto endpoint = std::make_shared<Endpoint>();
+        endpoint->address = address;
+        endpoint->ip = address.substr(0, address.rfind(':'));
+        endpoint->port = std::stoi(address.substr(address.rfind(':') + 1));
+        endpoint->weight = weight;
+        endpoints.push_back(endpoint);
+    }
+    return endpoints;
+}
+
+TEST(LoadBalancerTest, RoundRobinVisitsEveryInstance) {
+    auto balancer = LoadBalancer::Create("round_robin", MakeEndpoints({{"10.0.0.1:80", 1}, {"10.0.0.2:80", 1},
+                                                                       {"10.0.0.3:80", 1}}));
+    std::map<std::string, int> counts;
+    for (int i = 0; i < 300; ++i) {
+        ++counts[balancer->Select(0)->address];
+    }
+    ASSERT_EQ(counts.size(), 3u);
+    for (const auto& [address, count] : counts) {
+        EXPECT_EQ(count, 100) << address;
+    }
+}
+
+TEST(LoadBalancerTest, WeightedRandomFollowsWeights) {
+    auto balancer = LoadBalancer::Create("weighted_random", MakeEndpoints({{"10.0.0.1:80", 1}, {"10.0.0.2:80", 3}}));
+    std::map<std::string, int> counts;
+    for (int i = 0; i < 40000; ++i) {
+        ++counts[balancer->Select(0)->address];
+    }
+    // 期望约 1:3
+    EXPECT_NEAR(counts["10.0.0.2:80"] / 40000.0, 0.75, 0.03);
+}
+
+TEST(LoadBalancerTest, PowerOfTwoPrefersIdleInstance) {
+    EndpointList endpoints = MakeEndpoints({{"10.0.0.1:80", 1}, {"10.0.0.2:80", 1}});
+    endpoints[0]->inflight = 10;
+    auto balancer = LoadBalancer::Create("p2c_inflight", endpoints);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(balancer->Select(0)->address, "10.0.0.2:80");
+    }
+
+    endpoints[0]->inflight = 0;
+    endpoints[0]->RecordLatency(50000);
+    endpoints[1]->RecordLatency(1000);
+    auto ewma = LoadBalancer::Create("p2c_ewma", endpoints);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(ewma->Select(0)->address, "10.0.0.2:80");
+    }
+}
+
+TEST(LoadBalancerTest, ConsistentHashingIsStable) {
+    for (const char* policy : {"ring_hash", "maglev"}) {
+        auto endpoints = MakeEndpoints({{"10.0.0.1:80", 1}, {"10.0.0.2:80", 1}, {"10.0.0.3:80", 1},
+                                        {"10.0.0.4:80", 1}});
+        auto balancer = LoadBalancer::Create(policy, endpoints);
+        // 相同的键总是发往同一实例
+        EXPECT_EQ(balancer->Select(HashKey("user-42")), balancer->Select(HashKey("user-42"))) << policy;
+
+        // 移除一个实例后，原本不在该实例上的键大多保持不变
+        auto smaller = LoadBalancer::Create(policy, EndpointList(endpoints.begin(), endpoints.begin() + 3));
+        int kept = 0;
+        int total = 0;
+        std::map<std::string, int> counts;
+        for (int i = 0; i < 4000; ++i) {
+            uint64_t key = HashKey("key-" + std::to_string(i));
+            const std::string& before = balancer->Select(key)->address;
+            ++counts[before];
+            if (before == "10.0.0.4:80") {
+                continue;
+            }
+            ++total;
+            if (smaller->Select(key)->address == before) {
+                ++kept;
+            }
+        }
+        EXPECT_GT(kept, total * 9 / 10) << policy;
+        for (const auto& [address, count] : counts) {
+            EXPECT_GT(count, 600) << policy << " " << address;
+        }
+    }
+}
+
+TEST(LoadBalancerTest, UnknownPolicyThrows) {
+    EXPECT_THROW(LoadBalancer::Create("random_walk", MakeEndpoints({{"10.0.0.1:80", 1}})), std::invalid_argument);
+    EXPECT_THROW(LoadBalancer::Create("round_robin", EndpointList()), std::invalid_argument);
+}
+
+} // namespace xrpc
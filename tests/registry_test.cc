@@ -1,4 +1,5 @@
 #include "registry/zookeeper_client.h"
+#include "registry/service_instance.h"
 #include <gtest/gtest.h>
 #include <thread>
 #include <chrono>
@@ -59,11 +60,17 @@ TEST_F(ZookeeperClientTest, DiscoverService) {
     ASSERT_NO_THROW(zk_->Register(path2, data2, true));
 
     auto instances = zk_->DiscoverService("UserService");
-    ASSERT_EQ(instances.size(), 2);
-    EXPECT_TRUE(std::find_if(instances.begin(), instances.end(),
-                             [&path1, &data1](const auto& p) { return p.first == path1 && p.second == data1; }) != instances.end());
-    EXPECT_TRUE(std::find_if(instances.begin(), instances.end(),
-                             [&path2, &data2](const auto& p) { return p.first == path2 && p.second == data2; }) != instances.end());
+    ASSERT_EQ(instances->size(), 2);
+    EXPECT_TRUE(std::find_if(instances->begin(), instances->end(),
+                             [&path1, &data1](const auto& p) { return p.first == path1 && p.second == data1; }) != instances->end());
+    EXPECT_TRUE(std::find_if(instances->begin(), instances->end(),
+                             [&path2, &data2](const auto& p) { return p.first == path2 && p.second == data2; }) != instances->end());
+
+    // 缓存未变化时返回同一份快照；之后的修改发布新快照，已取得的列表保持不变
+    EXPECT_EQ(zk_->DiscoverService("UserService"), instances);
+    ASSERT_NO_THROW(zk_->Delete(path2));
+    EXPECT_EQ(zk_->DiscoverService("UserService")->size(), 1);
+    EXPECT_EQ(instances->size(), 2);
 }
 
 TEST_F(ZookeeperClientTest, FindInstancesByMethod) {
@@ -76,19 +83,38 @@ TEST_F(ZookeeperClientTest, FindInstancesByMethod) {
     ASSERT_NO_THROW(zk_->Register(path2, data2, true));
 
     auto instances = zk_->FindInstancesByMethod("UserService", "Login");
-    ASSERT_EQ(instances.size(), 2);
-    EXPECT_TRUE(std::find(instances.begin(), instances.end(), "127.0.0.1:8080") != instances.end());
-    EXPECT_TRUE(std::find(instances.begin(), instances.end(), "192.168.1.2:8081") != instances.end());
+    ASSERT_EQ(instances->size(), 2);
+    // 按地址排序
+    EXPECT_EQ((*instances)[0]->address, "127.0.0.1:8080");
+    EXPECT_EQ((*instances)[1]->address, "192.168.1.2:8081");
 
     instances = zk_->FindInstancesByMethod("UserService", "Register");
-    ASSERT_EQ(instances.size(), 1);
-    EXPECT_EQ(instances[0], "192.168.1.2:8081");
+    ASSERT_EQ(instances->size(), 1);
+    EXPECT_EQ((*instances)[0]->address, "192.168.1.2:8081");
+
+    // 未变化时返回同一份共享列表
+    EXPECT_EQ(zk_->FindInstancesByMethod("UserService", "Register"), instances);
+}
+
+TEST_F(ZookeeperClientTest, FindInstancesByMethodMatchesWholeNames) {
+    ASSERT_NO_THROW(zk_->Register("/UserService/127.0.0.1:8080", "methods=Login,Logout", true));
+    ASSERT_NO_THROW(zk_->Register("/UserService/127.0.0.1:8081", "methods=Log", true));
+
+    auto instances = zk_->FindInstancesByMethod("UserService", "Log");
+    ASSERT_EQ(instances->size(), 1);
+    EXPECT_EQ((*instances)[0]->address, "127.0.0.1:8081");
+    EXPECT_TRUE(zk_->FindInstancesByMethod("UserService", "Log,Login")->empty());
+
+    // 节点数据更新后索引随之更新
+    ASSERT_NO_THROW(zk_->Register("/UserService/127.0.0.1:8080", "methods=Log", true));
+    EXPECT_EQ(zk_->FindInstancesByMethod("UserService", "Log")->size(), 2);
+    EXPECT_TRUE(zk_->FindInstancesByMethod("UserService", "Login")->empty());
 }
 
 TEST_F(ZookeeperClientTest, DiscoverNonExistent) {
     std::string path = "/NonExistentService/127.0.0.1:9999";
     EXPECT_THROW(zk_->Discover(path), std::runtime_error);
-    EXPECT_TRUE(zk_->DiscoverService("NonExistentService").empty());
+    EXPECT_TRUE(zk_->DiscoverService("NonExistentService")->empty());
 }
 
 TEST_F(ZookeeperClientTest, DeleteNode) {
@@ -155,20 +181,37 @@ TEST_F(ZookeeperClientTest, WatchNode) {
     EXPECT_EQ(received_data[2], "");
 }
 
-TEST_F(ZookeeperClientTest, HeartbeatNodeCleanup) {
+TEST_F(ZookeeperClientTest, EphemeralNodeRemovedWithSession) {
     std::string path = "/UserService/127.0.0.1:8081";
-    std::string data = "methods=Other";
-
-    ASSERT_NO_THROW(zk_->Register(path, data, true));
-    std::string discovered = zk_->Discover(path);
-    EXPECT_EQ(discovered, data);
 
-    ASSERT_NO_THROW(zk_->Delete(path));
-    // 调整等待时间以匹配新的心跳间隔（2秒）
-    std::this_thread::sleep_for(std::chrono::seconds(4));
+    // 另一个客户端注册临时节点后关闭会话，ZooKeeper 删除节点，缓存由子节点监听更新
+    auto other = std::make_unique<ZookeeperClient>();
+    ASSERT_NO_THROW(other->Start());
+    ASSERT_NO_THROW(other->Register(path, "methods=Other", true));
+    ASSERT_EQ(zk_->DiscoverService("UserService")->size(), 1);
+
+    // 监听器无法注销，状态由监听器共同持有，用例结束后的通知不会访问已销毁的局部变量
+    struct Removal {
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool removed = false;
+    };
+    auto removal = std::make_shared<Removal>();
+    ZookeeperClient* zk = zk_.get();
+    zk_->AddServiceListener([removal, zk](const std::string& service) {
+        if (service == "UserService" && zk->DiscoverService("UserService")->empty()) {
+            std::lock_guard lock(removal->mtx);
+            removal->removed = true;
+            removal->cv.notify_one();
+        }
+    });
+    other.reset();
+    {
+        std::unique_lock lock(removal->mtx);
+        EXPECT_TRUE(removal->cv.wait_for(lock, std::chrono::seconds(5), [&] { return removal->removed; }));
+    }
     EXPECT_THROW(zk_->Discover(path), std::runtime_error);
-    auto instances = zk_->DiscoverService("UserService");
-    EXPECT_TRUE(instances.empty());
+    EXPECT_TRUE(zk_->DiscoverService("UserService")->empty());
 }
 
 TEST_F(ZookeeperClientTest, WatchNonExistentNode) {
@@ -220,4 +263,54 @@ TEST_F(ZookeeperClientTest, WatchNonExistentNode) {
     EXPECT_EQ(received_data[1], "");
 }
 
-} // namespace xrpc
\ No newline at end of file
+TEST_F(ZookeeperClientTest, ChildWatchPushesInstanceChanges) {
+    ASSERT_NO_THROW(zk_->Register("/UserService/127.0.0.1:8080", "methods=Login", true));
+    ASSERT_EQ(zk_->FindInstancesByMethod("UserService", "Login")->size(), 1);
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    int notifications = 0;
+    zk_->AddServiceListener([&](const std::string& service) {
+        if (service == "UserService") {
+            std::lock_guard lock(mtx);
+            ++notifications;
+            cv.notify_one();
+        }
+    });
+
+    // 另一个客户端注册和删除实例，变化应由 watch 推送，而不是等待定期核对
+    ZookeeperClient other;
+    ASSERT_NO_THROW(other.Start());
+    ASSERT_NO_THROW(other.Register("/UserService/127.0.0.1:8081", "methods=Login", true));
+    {
+        std::unique_lock lock(mtx);
+        cv.wait_for(lock, std::chrono::milliseconds(1000), [&] { return notifications >= 1; });
+    }
+    EXPECT_EQ(zk_->FindInstancesByMethod("UserService", "Login")->size(), 2);
+
+    ASSERT_NO_THROW(other.Delete("/UserService/127.0.0.1:8081"));
+    {
+        std::unique_lock lock(mtx);
+        cv.wait_for(lock, std::chrono::milliseconds(1000), [&] { return notifications >= 2; });
+    }
+    auto instances = zk_->FindInstancesByMethod("UserService", "Login");
+    ASSERT_EQ(instances->size(), 1);
+    EXPECT_EQ((*instances)[0]->address, "127.0.0.1:8080");
+}
+
+TEST(InstanceDataTest, FormatAndParse) {
+    std::string data = FormatInstanceData({"Login", "Register"}, 3);
+    InstanceInfo info;
+    ASSERT_TRUE(ParseInstanceData(data, &info));
+    EXPECT_EQ(info.methods, (std::vector<std::string>{"Login", "Register"}));
+    EXPECT_EQ(info.weight, 3u);
+
+    // 旧格式只有 methods 行，权重缺省为 1
+    ASSERT_TRUE(ParseInstanceData("methods=Login", &info));
+    EXPECT_EQ(info.methods, std::vector<std::string>{"Login"});
+    EXPECT_EQ(info.weight, 1u);
+
+    EXPECT_FALSE(ParseInstanceData("weight=2", &info));
+}
+
+} // namespace xrpc
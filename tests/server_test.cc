@@ -1,25 +1,92 @@
 #include <gtest/gtest.h>
 #include "core/server/xrpc_server.h"
+#include "core/channel/xrpc_channel.h"
+#include "core/controller/xrpc_controller.h"
 #include "core/common/xrpc_logger.h"
 #include "user_service.pb.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 #include <chrono>
+#include <vector>
 #include "registry/zookeeper_client.h"
 
 namespace xrpc {
 
 class MockUserService : public example::UserService {
 public:
+    // 设置后代替默认实现，需在发起调用前设置
+    using Handler = std::function<void(XrpcController* controller, example::LoginResponse* response,
+                                       google::protobuf::Closure* done)>;
+
     void Login(google::protobuf::RpcController* controller,
                const example::LoginRequest* request,
                example::LoginResponse* response,
                google::protobuf::Closure* done) override {
+        if (handler) {
+            handler(dynamic_cast<XrpcController*>(controller), response, done);
+            return;
+        }
         response->set_success(true);
         response->set_token("mock_token");
         if (done) done->Run();
     }
+
+    Handler handler;
+};
+
+// 简单的计数闩：Wait 等到计数达到 target 或超时
+class Latch {
+public:
+    void CountUp() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++count_;
+        cv_.notify_all();
+    }
+
+    bool Wait(int target, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, timeout, [&] { return count_ >= target; });
+    }
+
+    int Count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int count_ = 0;
 };
 
+// 在 threads 个线程上同时发起同步 Login，返回 check 为 true 的调用数
+template <typename Check>
+int ConcurrentLogin(XrpcChannel& channel, int threads, int64_t timeout_ms, Check check) {
+    std::atomic<int> matched{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&]() {
+            example::UserService_Stub stub(&channel);
+            XrpcController controller;
+            controller.SetTimeout(timeout_ms);
+            example::LoginRequest request;
+            example::LoginResponse response;
+            stub.Login(&controller, &request, &response, nullptr);
+            if (check(controller, response)) {
+                ++matched;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return matched.load();
+}
+
 class ServerTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -35,7 +102,7 @@ protected:
         bool registered = false;
         while (retries-- > 0) {
             auto instances = zk.FindInstancesByMethod("UserService", "Login");
-            if (!instances.empty()) {
+            if (!instances->empty()) {
                 registered = true;
                 break;
             }
@@ -62,4 +129,191 @@ TEST_F(ServerTest, RegisterAndStart) {
     EXPECT_TRUE(true);
 }
 
-} // namespace xrpc
\ No newline at end of file
+TEST_F(ServerTest, MethodDispatchTable) {
+    // 注册时已为每个方法建立分发表项
+    const MethodStats* stats = server_->GetMethodStats("UserService", "Login");
+    ASSERT_NE(stats, nullptr);
+    EXPECT_EQ(stats->calls.load(), 0u);
+    EXPECT_EQ(server_->GetMethodStats("UserService", "Logout"), nullptr);
+    EXPECT_EQ(server_->GetMethodStats("OrderService", "Login"), nullptr);
+}
+
+TEST_F(ServerTest, HandlersRunInParallel) {
+    // 每个处理函数都等到 kThreads 个调用同时进入才成功，处理函数不能并发执行时等待超时而失败
+    const int kThreads = 4; // 不超过配置的 handler_threads
+    Latch entered;
+    service_.handler = [&](XrpcController*, example::LoginResponse* response, google::protobuf::Closure* done) {
+        entered.CountUp();
+        response->set_success(entered.Wait(kThreads));
+        done->Run();
+    };
+
+    XrpcChannel channel(config_file_);
+    int succeeded = ConcurrentLogin(channel, kThreads, 0, [](XrpcController& controller,
+                                                             const example::LoginResponse& response) {
+        return !controller.Failed() && response.success();
+    });
+    EXPECT_EQ(succeeded, kThreads);
+}
+
+TEST_F(ServerTest, DeferredDoneDoesNotHoldWorkers) {
+    // 处理函数立即返回而不执行 done；并发调用数远多于工作线程数，不占用线程时所有调用都能同时进入处理函数
+    const int kThreads = 16;
+    Latch entered;
+    std::mutex mtx;
+    std::vector<std::pair<example::LoginResponse*, google::protobuf::Closure*>> pending;
+    service_.handler = [&](XrpcController*, example::LoginResponse* response, google::protobuf::Closure* done) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending.emplace_back(response, done);
+        }
+        entered.CountUp();
+    };
+    // 在本线程上完成已进入的调用
+    auto complete = [&]() {
+        std::vector<std::pair<example::LoginResponse*, google::protobuf::Closure*>> calls;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            calls.swap(pending);
+        }
+        for (auto& call : calls) {
+            call.first->set_success(true);
+            call.first->set_token("deferred_token");
+            call.second->Run();
+        }
+    };
+
+    XrpcChannel channel(config_file_);
+    int succeeded = 0;
+    std::thread callers([&]() {
+        succeeded = ConcurrentLogin(channel, kThreads, 0, [](XrpcController& controller,
+                                                             const example::LoginResponse& response) {
+            return !controller.Failed() && response.token() == "deferred_token";
+        });
+    });
+    EXPECT_TRUE(entered.Wait(kThreads));
+    // 断言失败时调用是陆续进入的，逐批完成，避免调用线程挂起
+    for (int completed = 0; completed < kThreads && entered.Wait(completed + 1);) {
+        completed = entered.Count();
+        complete();
+    }
+    callers.join();
+    EXPECT_EQ(succeeded, kThreads);
+}
+
+TEST_F(ServerTest, DeadlineReachesHandler) {
+    // 记录服务端控制器上的截止时间，验证截止时间随请求头传递
+    bool has_deadline = false;
+    std::chrono::milliseconds remaining{0};
+    service_.handler = [&](XrpcController* controller, example::LoginResponse* response,
+                           google::protobuf::Closure* done) {
+        has_deadline = controller->HasDeadline();
+        remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            controller->Deadline() - std::chrono::steady_clock::now());
+        response->set_success(true);
+        done->Run();
+    };
+
+    XrpcChannel channel(config_file_);
+    example::UserService_Stub stub(&channel);
+    XrpcController controller;
+    controller.SetTimeout(1000);
+    example::LoginRequest request;
+    example::LoginResponse response;
+    stub.Login(&controller, &request, &response, nullptr);
+    ASSERT_FALSE(controller.Failed());
+    EXPECT_TRUE(has_deadline);
+    EXPECT_GT(remaining.count(), 0);
+    EXPECT_LE(remaining.count(), 1000);
+}
+
+TEST_F(ServerTest, ExpiredRequestsAreShed) {
+    // 处理函数阻塞到放行，占住所有工作线程，其余请求排队直到调用方超时；放行后排队的请求在出队时被丢弃
+    const int kThreads = 16;
+    Latch entered;
+    Latch gate;
+    service_.handler = [&](XrpcController*, example::LoginResponse* response, google::protobuf::Closure* done) {
+        entered.CountUp();
+        gate.Wait(1);
+        response->set_success(true);
+        done->Run();
+    };
+
+    XrpcChannel channel(config_file_);
+    int timed_out = ConcurrentLogin(channel, kThreads, 100, [](XrpcController& controller,
+                                                               const example::LoginResponse&) {
+        return controller.GetErrorCode() == ErrorCode::TIMEOUT;
+    });
+    EXPECT_EQ(timed_out, kThreads);
+
+    // 放行后等待每个请求都被执行或丢弃
+    gate.CountUp();
+    const MethodStats* stats = server_->GetMethodStats("UserService", "Login");
+    ASSERT_NE(stats, nullptr);
+    for (int i = 0; i < 500 && stats->calls.load() + stats->expired.load() < static_cast<uint64_t>(kThreads); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    int handled = entered.Count();
+    EXPECT_LT(handled, kThreads);
+    EXPECT_EQ(stats->calls.load(), static_cast<uint64_t>(handled));
+    EXPECT_EQ(stats->expired.load(), static_cast<uint64_t>(kThreads - handled));
+    // 放行的处理函数可能仍在等待 gate，先停止服务端再销毁局部变量
+    server_.reset();
+}
+
+TEST_F(ServerTest, ResponseHeaderDoesNotEchoMetadata) {
+    // 直接发送带元数据的请求帧，响应头只带回请求 ID 和服务、方法名
+    XrpcCodec codec;
+    RpcHeader header;
+    header.set_service_name("UserService");
+    header.set_method_name("Login");
+    header.set_request_id(42);
+    (*header.mutable_metadata())[kTimeoutMetadataKey] = "1000";
+    example::LoginRequest request;
+
+    AsioTransport client;
+    std::string response_data;
+    ASSERT_EQ(client.SendFrame("127.0.0.1", 8080, 42, codec.Encode(header, request, FrameBuffer::kHeaderSize),
+                               response_data, std::chrono::seconds(2)), CallStatus::OK);
+    RpcHeader response_header;
+    example::LoginResponse response;
+    ASSERT_TRUE(codec.DecodeResponse(response_data, response_header, response));
+    EXPECT_EQ(response_header.status(), 0);
+    EXPECT_EQ(response_header.request_id(), 42u);
+    EXPECT_EQ(response_header.service_name(), "UserService");
+    EXPECT_EQ(response_header.method_name(), "Login");
+    EXPECT_TRUE(response_header.metadata().empty());
+    EXPECT_EQ(response.token(), "mock_token");
+    client.Stop();
+}
+
+TEST_F(ServerTest, HandlerExceptionIsReported) {
+    // 处理函数未执行 done 就抛出异常，客户端收到带异常信息的错误，之后的调用不受影响
+    service_.handler = [](XrpcController*, example::LoginResponse*, google::protobuf::Closure*) {
+        throw std::runtime_error("handler exploded");
+    };
+
+    XrpcChannel channel(config_file_);
+    example::UserService_Stub stub(&channel);
+    {
+        XrpcController controller;
+        example::LoginRequest request;
+        example::LoginResponse response;
+        stub.Login(&controller, &request, &response, nullptr);
+        EXPECT_TRUE(controller.Failed());
+        EXPECT_EQ(controller.ErrorText(), "handler exploded");
+    }
+    const MethodStats* stats = server_->GetMethodStats("UserService", "Login");
+    ASSERT_NE(stats, nullptr);
+    EXPECT_EQ(stats->failures.load(), 1u);
+
+    service_.handler = nullptr;
+    XrpcController controller;
+    example::LoginRequest request;
+    example::LoginResponse response;
+    stub.Login(&controller, &request, &response, nullptr);
+    ASSERT_FALSE(controller.Failed());
+    EXPECT_EQ(response.token(), "mock_token");
+}
+
+} // namespace xrpc
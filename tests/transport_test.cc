@@ -0,0 +1,564 @@
+#include <gtest/gtest.h>
+#include "transport/asio_transport.h"
+#include "transport/frame_buffer.h"
+#include "transport/io_context_pool.h"
+#include "transport/timer_wheel.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace xrpc {
+
+// 模拟 socket 读取：把数据写入 FrameBuffer
+static void Feed(FrameBuffer& buffer, const std::string& data) {
+    char* ptr = buffer.PrepareWrite(data.size());
+    std::memcpy(ptr, data.data(), data.size());
+    buffer.CommitWrite(data.size());
+}
+
+TEST(FrameBufferTest, MultipleFramesInOneRead) {
+    FrameBuffer buffer;
+    Feed(buffer, FrameBuffer::Pack("first", 1) + FrameBuffer::Pack("", 2) + FrameBuffer::Pack("third", 1ULL << 40));
+
+    std::string frame;
+    uint64_t request_id = 0;
+    ASSERT_TRUE(buffer.NextFrame(&frame, &request_id));
+    EXPECT_EQ(frame, "first");
+    EXPECT_EQ(request_id, 1u);
+    ASSERT_TRUE(buffer.NextFrame(&frame, &request_id));
+    EXPECT_EQ(frame, "");
+    EXPECT_EQ(request_id, 2u);
+    ASSERT_TRUE(buffer.NextFrame(&frame, &request_id));
+    EXPECT_EQ(frame, "third");
+    EXPECT_EQ(request_id, 1ULL << 40);
+    EXPECT_FALSE(buffer.NextFrame(&frame));
+    EXPECT_EQ(buffer.ReadableBytes(), 0u);
+}
+
+TEST(FrameBufferTest, PartialFrameAcrossReads) {
+    FrameBuffer buffer;
+    std::string payload(100000, 'x'); // 大于初始缓冲区
+    std::string packed = FrameBuffer::Pack(payload);
+
+    std::string frame;
+    for (size_t offset = 0; offset < packed.size(); offset += 3000) {
+        EXPECT_FALSE(buffer.NextFrame(&frame));
+        Feed(buffer, packed.substr(offset, 3000));
+    }
+    ASSERT_TRUE(buffer.NextFrame(&frame));
+    EXPECT_EQ(frame, payload);
+    EXPECT_FALSE(buffer.HasError());
+}
+
+TEST(FrameBufferTest, OversizedFrameIsRejected) {
+    FrameBuffer buffer;
+    char header[FrameBuffer::kHeaderSize];
+    FrameBuffer::EncodeHeader(FrameBuffer::kMaxFrameSize + 1, 0, header);
+    Feed(buffer, std::string(header, sizeof(header)));
+
+    std::string frame;
+    EXPECT_FALSE(buffer.NextFrame(&frame));
+    EXPECT_TRUE(buffer.HasError());
+}
+
+TEST(FrameBufferTest, FrameViewSurvivesBufferReuse) {
+    FrameBuffer buffer;
+    Feed(buffer, FrameBuffer::Pack("first", 1) + FrameBuffer::Pack("second", 2));
+
+    FrameView first;
+    FrameView second;
+    ASSERT_TRUE(buffer.NextFrame(&first));
+    ASSERT_TRUE(buffer.NextFrame(&second));
+
+    // 视图未释放时继续写入大量数据，不能覆盖视图指向的内容
+    std::string payload(100000, 'y');
+    Feed(buffer, FrameBuffer::Pack(payload, 3));
+    EXPECT_EQ(first.View(), "first");
+    EXPECT_EQ(second.View(), "second");
+
+    FrameView third;
+    uint64_t request_id = 0;
+    ASSERT_TRUE(buffer.NextFrame(&third, &request_id));
+    EXPECT_EQ(request_id, 3u);
+    EXPECT_EQ(third.View(), payload);
+}
+
+TEST(FrameBufferTest, CancelFrameHasEmptyPayload) {
+    FrameBuffer buffer;
+    Feed(buffer, FrameBuffer::PackCancel(42));
+    FrameView view;
+    uint64_t request_id = 0;
+    ASSERT_TRUE(buffer.NextFrame(&view, &request_id));
+    EXPECT_EQ(view.size, 0u);
+    EXPECT_EQ(request_id, 42u);
+}
+
+TEST(IoContextPoolTest, RoundRobin) {
+    IoContextPool pool(3);
+    EXPECT_EQ(pool.Size(), 3u);
+    EXPECT_EQ(pool.Next(), 0u);
+    EXPECT_EQ(pool.Next(), 1u);
+    EXPECT_EQ(pool.Next(), 2u);
+    EXPECT_EQ(pool.Next(), 0u);
+}
+
+TEST(IoContextPoolTest, LeastLoad) {
+    IoContextPool pool(3, IoContextPool::Balance::LEAST_LOAD);
+    pool.AddLoad(0, 2);
+    pool.AddLoad(1, 1);
+    EXPECT_EQ(pool.Next(), 2u);
+    pool.AddLoad(2, 3);
+    EXPECT_EQ(pool.Next(), 1u);
+}
+
+TEST(AsioTransportTest, LargePayloadRoundTrip) {
+    AsioTransport server(4);
+    server.StartServer("127.0.0.1", 18081, [](std::string_view request, std::string& response) {
+        response = std::string(request);
+    });
+
+    AsioTransport client;
+    client.Connect("127.0.0.1", 18081);
+
+    std::string payload(1024 * 1024, 'p');
+    std::string response;
+    ASSERT_TRUE(client.Send(1, payload, response));
+    EXPECT_EQ(response, payload);
+
+    ASSERT_TRUE(client.Send(2, "small", response));
+    EXPECT_EQ(response, "small");
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(AsioTransportTest, ReusePortAcceptors) {
+    AsioTransport server(4);
+    server.StartServer("127.0.0.1", 18082, [](std::string_view request, std::string& response) {
+        response = "echo:" + std::string(request);
+    }, true);
+
+    // 多个客户端连接由内核分发到不同 acceptor
+    for (int i = 0; i < 8; ++i) {
+        AsioTransport client;
+        client.Connect("127.0.0.1", 18082);
+        std::string response;
+        ASSERT_TRUE(client.Send(1, std::to_string(i), response));
+        EXPECT_EQ(response, "echo:" + std::to_string(i));
+        client.Stop();
+    }
+    server.Stop();
+}
+
+TEST(AsioTransportTest, MultiplexedAsyncCalls) {
+    AsioTransport server(2);
+    server.StartServer("127.0.0.1", 18083, [](std::string_view request, std::string& response) {
+        response = "echo:" + std::string(request);
+    });
+
+    AsioTransport client;
+    client.Connect("127.0.0.1", 18083);
+
+    // 同一连接上同时发出多个请求，响应按 request_id 回到各自的回调
+    const int kCalls = 200;
+    std::mutex mtx;
+    std::condition_variable cv;
+    int completed = 0;
+    int matched = 0;
+    for (int i = 0; i < kCalls; ++i) {
+        std::string payload = std::to_string(i);
+        client.SendAsync(i + 1, payload, [&, payload](const std::string& response, bool success) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (success && response == "echo:" + payload) {
+                ++matched;
+            }
+            ++completed;
+            cv.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(5), [&] { return completed == kCalls; });
+    }
+    EXPECT_EQ(completed, kCalls);
+    EXPECT_EQ(matched, kCalls);
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(AsioTransportTest, OutOfOrderResponses) {
+    // 读连接的 reactor 不执行请求，至少还需两个 reactor 才能让两个请求同时处理
+    AsioTransport server(4);
+    server.StartServer("127.0.0.1", 18084, [](std::string_view request, std::string& response) {
+        if (request == "slow") {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }
+        response = std::string(request);
+    });
+
+    AsioTransport client;
+    client.Connect("127.0.0.1", 18084);
+
+    // 同一连接上慢请求先发，快请求应先返回
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::string> order;
+    auto callback = [&](const std::string& response, bool success) {
+        std::lock_guard<std::mutex> lock(mtx);
+        order.push_back(success ? response : "failed");
+        cv.notify_one();
+    };
+    client.SendAsync(1, "slow", callback);
+    client.SendAsync(2, "fast", callback);
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(5), [&] { return order.size() == 2; });
+    }
+    ASSERT_EQ(order.size(), 2u);
+    EXPECT_EQ(order[0], "fast");
+    EXPECT_EQ(order[1], "slow");
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(AsioTransportTest, SlowReaderPausesReading) {
+    const size_t kResponseSize = 1024 * 1024;
+    std::atomic<int> handled{0};
+    AsioTransport server(2);
+    server.SetWriteHighWaterMark(128 * 1024);
+    server.StartServer("127.0.0.1", 18085, [&](std::string_view request, std::string& response) {
+        ++handled;
+        response.assign(kResponseSize, 'r');
+    });
+
+    // 客户端只发不收，服务端发送积压超过高水位后应停止读取新请求
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::socket socket(io_context);
+    socket.connect({boost::asio::ip::address::from_string("127.0.0.1"), 18085});
+    const int kRequests = 40;
+    for (int i = 0; i < kRequests; ++i) {
+        boost::asio::write(socket, boost::asio::buffer(FrameBuffer::Pack("req", i + 1)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_LT(handled.load(), kRequests);
+
+    // 开始读取后积压回落，剩余请求继续被处理
+    std::vector<char> responses(kRequests * (FrameBuffer::kHeaderSize + kResponseSize));
+    boost::system::error_code ec;
+    boost::asio::read(socket, boost::asio::buffer(responses), ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(handled.load(), kRequests);
+
+    socket.close();
+    server.Stop();
+}
+
+TEST(AsioTransportTest, ConnectionPoolPerEndpoint) {
+    auto handler = [&](std::string_view request, std::string& response) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        response = std::string(request);
+    };
+    AsioTransport server_a(2);
+    server_a.StartServer("127.0.0.1", 18086, [&](std::string_view request, std::string& response) {
+        handler(request, response);
+        response = "a:" + response;
+    });
+    AsioTransport server_b(2);
+    server_b.StartServer("127.0.0.1", 18087, [&](std::string_view request, std::string& response) {
+        handler(request, response);
+        response = "b:" + response;
+    });
+
+    // 同一个客户端按地址访问不同服务端
+    AsioTransport client(2);
+    client.SetConnectionPoolSize(1, 4);
+    std::string response;
+    ASSERT_TRUE(client.Send("127.0.0.1", 18086, 1, "x", response));
+    EXPECT_EQ(response, "a:x");
+    ASSERT_TRUE(client.Send("127.0.0.1", 18087, 2, "y", response));
+    EXPECT_EQ(response, "b:y");
+
+    // 大量并发请求下连接池按需扩容，所有请求都能完成
+    const int kCalls = 200;
+    std::mutex mtx;
+    std::condition_variable cv;
+    int completed = 0;
+    for (int i = 0; i < kCalls; ++i) {
+        client.SendAsync("127.0.0.1", 18086, 100 + i, "z", [&](const std::string& response, bool success) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (success && response == "a:z") {
+                ++completed;
+            }
+            cv.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(10), [&] { return completed == kCalls; });
+    }
+    EXPECT_EQ(completed, kCalls);
+    EXPECT_GT(client.PoolSize("127.0.0.1", 18086), 1u);
+    EXPECT_LE(client.PoolSize("127.0.0.1", 18086), 4u);
+    EXPECT_EQ(client.PoolSize("127.0.0.1", 18087), 1u);
+
+    // 无法连接的地址直接失败
+    EXPECT_FALSE(client.Send("127.0.0.1", 18089, 3, "x", response));
+
+    client.Stop();
+    server_a.Stop();
+    server_b.Stop();
+}
+
+TEST(AsioTransportTest, ConcurrentSyncCalls) {
+    AsioTransport server(8);
+    server.StartServer("127.0.0.1", 18088, [](std::string_view request, std::string& response) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        response = std::string(request);
+    });
+
+    AsioTransport client;
+    client.Connect("127.0.0.1", 18088);
+
+    // 多个线程共享同一个客户端做同步调用，应并行而不是串行完成
+    const int kThreads = 8;
+    std::atomic<int> succeeded{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i]() {
+            std::string response;
+            if (client.Send(i + 1, std::to_string(i), response) && response == std::to_string(i)) {
+                ++succeeded;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(succeeded.load(), kThreads);
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100 * kThreads / 2));
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(TimerWheelTest, ExpiresAfterTimeout) {
+    boost::asio::io_context io_context;
+    std::vector<std::pair<uint64_t, std::chrono::steady_clock::duration>> expired;
+    auto start = std::chrono::steady_clock::now();
+    // 4 个槽、每槽 10ms：50ms 的超时需要多转一圈
+    TimerWheel wheel(io_context, std::chrono::milliseconds(10), 4, [&](uint64_t id) {
+        expired.emplace_back(id, std::chrono::steady_clock::now() - start);
+    });
+    wheel.Add(1, std::chrono::milliseconds(50));
+    wheel.Add(2, std::chrono::milliseconds(20));
+    wheel.Add(3, std::chrono::milliseconds(1));
+    EXPECT_EQ(wheel.Size(), 3u);
+    io_context.run(); // 轮空后定时器不再挂起，run 返回
+
+    ASSERT_EQ(expired.size(), 3u);
+    EXPECT_EQ(expired[0].first, 3u);
+    EXPECT_EQ(expired[1].first, 2u);
+    EXPECT_EQ(expired[2].first, 1u);
+    EXPECT_GE(expired[1].second, std::chrono::milliseconds(20));
+    EXPECT_GE(expired[2].second, std::chrono::milliseconds(50));
+    EXPECT_EQ(wheel.Size(), 0u);
+}
+
+TEST(TimerWheelTest, AddMidTickDoesNotExpireEarly) {
+    boost::asio::io_context io_context;
+    std::chrono::steady_clock::time_point added;
+    std::chrono::steady_clock::duration waited{0};
+    TimerWheel wheel(io_context, std::chrono::milliseconds(50), 8, [&](uint64_t id) {
+        if (id == 2) {
+            waited = std::chrono::steady_clock::now() - added;
+        }
+    });
+    wheel.Add(1, std::chrono::milliseconds(200)); // 让时间轮开始转动
+    // 在一个 tick 过去大半时加入只有一个 tick 的任务，不能在本 tick 结束时就到期
+    boost::asio::steady_timer timer(io_context, std::chrono::milliseconds(40));
+    timer.async_wait([&](const boost::system::error_code&) {
+        added = std::chrono::steady_clock::now();
+        wheel.Add(2, std::chrono::milliseconds(50));
+    });
+    io_context.run();
+    EXPECT_GE(waited, std::chrono::milliseconds(50));
+}
+
+TEST(TimerWheelTest, RemovedEntriesDoNotKeepTimerArmed) {
+    boost::asio::io_context io_context;
+    std::vector<uint64_t> expired;
+    TimerWheel wheel(io_context, std::chrono::milliseconds(10), 4, [&](uint64_t id) { expired.push_back(id); });
+    size_t slot = wheel.Add(1, std::chrono::seconds(60));
+    wheel.Add(2, std::chrono::milliseconds(20));
+    wheel.Remove(1, slot);
+    wheel.Remove(3, slot); // 不存在的任务被忽略
+    EXPECT_EQ(wheel.Size(), 1u);
+
+    // 删除的任务不再让定时器挂起，任务 2 到期后 run 即返回
+    auto start = std::chrono::steady_clock::now();
+    io_context.run();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(30));
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], 2u);
+    EXPECT_EQ(wheel.Size(), 0u);
+}
+
+TEST(AsioTransportTest, CallTimesOut) {
+    // 服务端只回复 "fast"，其余请求永不回复
+    AsioTransport server(2);
+    server.StartAsyncServer("127.0.0.1", 18090, [](FrameView request, AsioTransport::Responder respond) {
+        if (request.View() == "fast") {
+            respond(FrameBuffer::Pack("ok"));
+        }
+    });
+
+    AsioTransport client;
+    std::string response;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(client.SendFrame("127.0.0.1", 18090, 1, FrameBuffer::Pack("hang"), response,
+                               std::chrono::milliseconds(100)), CallStatus::TIMEOUT);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<CallStatus> statuses;
+    auto callback = [&](const std::string&, CallStatus status) {
+        std::lock_guard<std::mutex> lock(mtx);
+        statuses.push_back(status);
+        cv.notify_one();
+    };
+    client.SendFrameAsync("127.0.0.1", 18090, 2, FrameBuffer::Pack("hang"), callback, std::chrono::milliseconds(50));
+    client.SendFrameAsync("127.0.0.1", 18090, 3, FrameBuffer::Pack("fast"), callback, std::chrono::milliseconds(1000));
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(5), [&] { return statuses.size() == 2; });
+    }
+    ASSERT_EQ(statuses.size(), 2u);
+    EXPECT_EQ(statuses[0], CallStatus::OK);
+    EXPECT_EQ(statuses[1], CallStatus::TIMEOUT);
+
+    // 超时的请求已释放，连接上没有残留的未完成请求，之后的调用不受影响
+    EXPECT_EQ(client.SendFrame("127.0.0.1", 18090, 4, FrameBuffer::Pack("fast"), response,
+                               std::chrono::milliseconds(1000)), CallStatus::OK);
+    EXPECT_EQ(response, "ok");
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(AsioTransportTest, PostSpreadsTasksUnderLeastLoad) {
+    // LEAST_LOAD 只影响连接分配，投递的任务仍轮询到各个 reactor
+    AsioTransport transport(4, IoContextPool::Balance::LEAST_LOAD);
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::set<std::thread::id> threads;
+    int finished = 0;
+    for (int i = 0; i < 8; ++i) {
+        transport.Post([&]() {
+            std::lock_guard<std::mutex> lock(mtx);
+            threads.insert(std::this_thread::get_id());
+            ++finished;
+            cv.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] { return finished == 8; }));
+    }
+    EXPECT_EQ(threads.size(), 4u);
+    transport.Stop();
+}
+
+TEST(AsioTransportTest, SyncCallOnReactorFailsFast) {
+    AsioTransport server(2);
+    server.StartServer("127.0.0.1", 18092, [](std::string_view request, std::string& response) {
+        response = std::string(request);
+    });
+
+    // 只有一个 reactor，响应回调和投递的任务都在它上面执行；其中的同步调用同一连接也不能挂起
+    AsioTransport client;
+    std::promise<CallStatus> nested_in_callback;
+    client.SendFrameAsync("127.0.0.1", 18092, 1, FrameBuffer::Pack("outer"),
+                          [&](const std::string& response, CallStatus status) {
+                              std::string nested;
+                              nested_in_callback.set_value(
+                                  client.SendFrame("127.0.0.1", 18092, 2, FrameBuffer::Pack("inner"), nested));
+                          });
+    auto callback_status = nested_in_callback.get_future();
+    ASSERT_EQ(callback_status.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(callback_status.get(), CallStatus::FAILED);
+
+    std::promise<CallStatus> nested_in_task;
+    client.Post([&]() {
+        std::string response;
+        nested_in_task.set_value(client.SendFrame("127.0.0.1", 18092, 3, FrameBuffer::Pack("task"), response));
+    });
+    auto task_status = nested_in_task.get_future();
+    ASSERT_EQ(task_status.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(task_status.get(), CallStatus::FAILED);
+
+    // 拒绝的调用不影响连接，之后在普通线程上的同步调用正常完成
+    std::string response;
+    EXPECT_EQ(client.SendFrame("127.0.0.1", 18092, 4, FrameBuffer::Pack("after"), response), CallStatus::OK);
+    EXPECT_EQ(response, "after");
+
+    client.Stop();
+    server.Stop();
+}
+
+TEST(AsioTransportTest, CancelReachesServer) {
+    // 服务端不回复，只等待取消回调
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::string> cancelled;
+    AsioTransport server(2);
+    server.StartCancellableServer("127.0.0.1", 18091, [&](FrameView request, AsioTransport::Responder respond) {
+        std::string payload(request.View());
+        return AsioTransport::CancelHook([&, payload]() {
+            std::lock_guard<std::mutex> lock(mtx);
+            cancelled.push_back(payload);
+            cv.notify_one();
+        });
+    });
+
+    AsioTransport client;
+    std::vector<CallStatus> statuses;
+    auto callback = [&](const std::string&, CallStatus status) {
+        std::lock_guard<std::mutex> lock(mtx);
+        statuses.push_back(status);
+        cv.notify_one();
+    };
+    client.SendFrameAsync("127.0.0.1", 18091, 1, FrameBuffer::Pack("first"), callback);
+    client.SendFrameAsync("127.0.0.1", 18091, 2, FrameBuffer::Pack("second"), callback);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    client.CancelCall(2);
+    client.CancelCall(2); // 已取消的请求再次取消不产生效果
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(2), [&] { return !cancelled.empty(); });
+    }
+    ASSERT_EQ(statuses.size(), 1u);
+    EXPECT_EQ(statuses[0], CallStatus::CANCELLED);
+    ASSERT_EQ(cancelled.size(), 1u);
+    EXPECT_EQ(cancelled[0], "second");
+
+    client.Stop();
+    server.Stop();
+}
+
+} // namespace xrpc
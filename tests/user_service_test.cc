@@ -43,7 +43,7 @@ protected:
         bool registered = false;
         while (retries-- > 0) {
             auto instances = zk.FindInstancesByMethod("UserService", "Login");
-            if (!instances.empty()) {
+            if (!instances->empty()) {
                 registered = true;
                 break;
             }
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "core/server/worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace xrpc {
+
+TEST(WorkerPoolTest, RunsAllTasks) {
+    WorkerPool pool(4);
+    EXPECT_EQ(pool.Size(), 4u);
+
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 1000; ++i) {
+        pool.Submit([&counter]() { ++counter; });
+    }
+    pool.Stop(); // 停止前执行完已提交的任务
+    EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(WorkerPoolTest, IdleWorkersStealTasks) {
+    WorkerPool pool(4);
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::set<std::thread::id> threads;
+    int completed = 0;
+
+    // 所有子任务都由同一个工作线程提交到自己的队列，其他线程只能通过窃取参与执行
+    const int kTasks = 40;
+    pool.Submit([&]() {
+        for (int i = 0; i < kTasks; ++i) {
+            pool.Submit([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                std::lock_guard<std::mutex> lock(mtx);
+                threads.insert(std::this_thread::get_id());
+                ++completed;
+                cv.notify_one();
+            });
+        }
+    });
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(5), [&] { return completed == kTasks; });
+    }
+    EXPECT_EQ(completed, kTasks);
+    EXPECT_GT(threads.size(), 1u);
+}
+
+} // namespace xrpc